@@ -37,10 +37,18 @@
         'browser/default_web_contents_delegate_mac.mm',
         'browser/devtools_embedder_message_dispatcher.cc',
         'browser/devtools_embedder_message_dispatcher.h',
+        'browser/devtools_file_system_indexer.cc',
+        'browser/devtools_file_system_indexer.h',
+        'browser/devtools_file_writer.cc',
+        'browser/devtools_file_writer.h',
         'browser/devtools_ui.cc',
         'browser/devtools_ui.h',
         'browser/download_manager_delegate.cc',
         'browser/download_manager_delegate.h',
+        'browser/file_pref_store.cc',
+        'browser/file_pref_store.h',
+        'browser/in_memory_pref_store.cc',
+        'browser/in_memory_pref_store.h',
         'browser/inspectable_web_contents.cc',
         'browser/inspectable_web_contents.h',
         'browser/inspectable_web_contents_delegate.h',
@@ -49,6 +57,8 @@
         'browser/inspectable_web_contents_view.h',
         'browser/inspectable_web_contents_view_mac.h',
         'browser/inspectable_web_contents_view_mac.mm',
+        'browser/isolated_url_request_context_getter.cc',
+        'browser/isolated_url_request_context_getter.h',
         'browser/linux/inspectable_web_contents_view_linux.h',
         'browser/linux/inspectable_web_contents_view_linux.cc',
         'browser/mac/bry_application.h',
@@ -60,6 +70,33 @@
         'browser/media/media_capture_devices_dispatcher.h',
         'browser/media/media_stream_devices_controller.cc',
         'browser/media/media_stream_devices_controller.h',
+        'browser/media_url_request_context_getter.cc',
+        'browser/media_url_request_context_getter.h',
+        'browser/net/archive_protocol_handler.cc',
+        'browser/net/archive_protocol_handler.h',
+        'browser/net/caching_proxy_resolver.cc',
+        'browser/net/caching_proxy_resolver.h',
+        'browser/net/http_cache_config.h',
+        'browser/net/http_server_properties_manager.cc',
+        'browser/net/http_server_properties_manager.h',
+        'browser/net/mapped_file_protocol_handler.cc',
+        'browser/net/mapped_file_protocol_handler.h',
+        'browser/net/network_stats.cc',
+        'browser/net/network_stats.h',
+        'browser/net/request_scheduler.cc',
+        'browser/net/request_scheduler.h',
+        'browser/net/resource_archive.cc',
+        'browser/net/resource_archive.h',
+        'browser/net/sqlite_server_bound_cert_store.cc',
+        'browser/net/sqlite_server_bound_cert_store.h',
+        'browser/net/tiered_cache_backend.cc',
+        'browser/net/tiered_cache_backend.h',
+        'browser/net/transport_security_persister.cc',
+        'browser/net/transport_security_persister.h',
+        'browser/net/url_request_mapped_job.cc',
+        'browser/net/url_request_mapped_job.h',
+        'browser/net/url_rule_set.cc',
+        'browser/net/url_rule_set.h',
         'browser/network_delegate.cc',
         'browser/network_delegate.h',
         'browser/notification_presenter.h',
@@ -86,6 +123,12 @@
         'common/main_delegate.cc',
         'common/main_delegate.h',
         'common/main_delegate_mac.mm',
+        'common/resource_bundle_delegate.cc',
+        'common/resource_bundle_delegate.h',
+        'common/startup_timeline.cc',
+        'common/startup_timeline.h',
+        'common/switches.cc',
+        'common/switches.h',
       ],
       'conditions': [
         ['OS=="linux"', {
@@ -119,5 +162,15 @@
         }],
       ],
     },
+    {
+      'target_name': 'cache_backend_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'brightray',
+      ],
+      'sources': [
+        'tools/cache_backend_benchmark.cc',
+      ],
+    },
   ],
 }
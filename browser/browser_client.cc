@@ -8,6 +8,9 @@
 #include "browser/browser_main_parts.h"
 #include "browser/media/media_capture_devices_dispatcher.h"
 #include "browser/notification_presenter.h"
+#include "common/startup_timeline.h"
+
+#include "content/public/browser/browser_thread.h"
 
 namespace brightray {
 
@@ -58,7 +61,27 @@ net::URLRequestContextGetter* BrowserClient::CreateRequestContext(
     content::BrowserContext* browser_context,
     content::ProtocolHandlerMap* protocol_handlers) {
   auto context = static_cast<BrowserContext*>(browser_context);
-  return context->CreateRequestContext(protocol_handlers);
+  net::URLRequestContextGetter* getter;
+  {
+    ScopedStartupPhase phase("BrowserClient::CreateRequestContext");
+    getter = context->CreateRequestContext(protocol_handlers);
+  }
+  StartupTimeline::ReachMilestone(
+      StartupTimeline::REQUEST_CONTEXT_CREATED,
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::FILE));
+  return getter;
+}
+
+net::URLRequestContextGetter*
+    BrowserClient::CreateRequestContextForStoragePartition(
+        content::BrowserContext* browser_context,
+        const base::FilePath& partition_path,
+        bool in_memory,
+        content::ProtocolHandlerMap* protocol_handlers) {
+  auto context = static_cast<BrowserContext*>(browser_context);
+  return context->CreateRequestContextForStoragePartition(
+      partition_path, in_memory, protocol_handlers);
 }
 
 void BrowserClient::ShowDesktopNotification(
@@ -36,6 +36,13 @@ class BrowserClient : public content::ContentBrowserClient {
   virtual net::URLRequestContextGetter* CreateRequestContext(
       content::BrowserContext*, content::ProtocolHandlerMap*) OVERRIDE;
 
+  // Same as above for storage partitions other than the default one.
+  virtual net::URLRequestContextGetter* CreateRequestContextForStoragePartition(
+      content::BrowserContext*,
+      const base::FilePath& partition_path,
+      bool in_memory,
+      content::ProtocolHandlerMap*) OVERRIDE;
+
  private:
   virtual content::BrowserMainParts* CreateBrowserMainParts(
       const content::MainFunctionParams&) OVERRIDE;
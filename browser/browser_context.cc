@@ -4,8 +4,13 @@
 
 #include "browser/browser_context.h"
 
+#include "browser/devtools_file_system_indexer.h"
 #include "browser/download_manager_delegate.h"
+#include "browser/in_memory_pref_store.h"
 #include "browser/inspectable_web_contents_impl.h"
+#include "browser/isolated_url_request_context_getter.h"
+#include "browser/media_url_request_context_getter.h"
+#include "browser/net/http_server_properties_manager.h"
 #include "browser/network_delegate.h"
 #include "browser/url_request_context_getter.h"
 #include "common/application_info.h"
@@ -17,9 +22,12 @@
 #include "base/prefs/pref_registry_simple.h"
 #include "base/prefs/pref_service.h"
 #include "base/prefs/pref_service_builder.h"
+#include "base/task_runner_util.h"
 #include "content/public/browser/browser_thread.h"
+#include "content/public/browser/render_process_host.h"
 #include "content/public/browser/resource_context.h"
 #include "content/public/browser/storage_partition.h"
+#include "net/proxy/proxy_config.h"
 
 #if defined(OS_LINUX)
 #include "base/nix/xdg_util.h"
@@ -27,6 +35,66 @@
 
 namespace brightray {
 
+namespace {
+
+// ImportantFileWriter's default.
+const int kDefaultPrefsCommitIntervalSeconds = 10;
+
+void RunPrefsLoadedCallback(const base::Closure& callback, bool succeeded) {
+  callback.Run();
+}
+
+HttpCacheStats GetHttpCacheStatsOnIOThread(
+    scoped_refptr<URLRequestContextGetter> getter) {
+  return getter->http_cache_stats();
+}
+
+HttpCacheStats GetMediaHttpCacheStatsOnIOThread(
+    scoped_refptr<MediaURLRequestContextGetter> getter) {
+  return getter->http_cache_stats();
+}
+
+ProxyResolverStats GetProxyResolverStatsOnIOThread(
+    scoped_refptr<URLRequestContextGetter> getter) {
+  return getter->proxy_resolver_stats();
+}
+
+ServerBoundCertStats GetServerBoundCertStatsOnIOThread(
+    scoped_refptr<URLRequestContextGetter> getter) {
+  return getter->server_bound_cert_stats();
+}
+
+NetworkStats GetNetworkStatsOnIOThread(
+    scoped_refptr<URLRequestContextGetter> getter) {
+  auto network_delegate = getter->network_delegate();
+  if (!network_delegate)
+    return NetworkStats();
+  return network_delegate->stats();
+}
+
+RequestSchedulerStats GetRequestSchedulerStatsOnIOThread(
+    scoped_refptr<URLRequestContextGetter> getter) {
+  auto network_delegate = getter->network_delegate();
+  if (!network_delegate)
+    return RequestSchedulerStats();
+  return network_delegate->request_scheduler_stats();
+}
+
+void SetRequestSchedulerConfigOnIOThread(
+    scoped_refptr<URLRequestContextGetter> getter,
+    const RequestSchedulerConfig& config) {
+  getter->GetURLRequestContext();
+  getter->network_delegate()->SetRequestSchedulerConfig(config);
+}
+
+void SetURLRulesOnIOThread(scoped_refptr<URLRequestContextGetter> getter,
+                           const URLRuleList& rules) {
+  getter->GetURLRequestContext();
+  getter->network_delegate()->SetURLRules(rules);
+}
+
+}  // namespace
+
 class BrowserContext::ResourceContext : public content::ResourceContext {
  public:
   ResourceContext() : getter_(nullptr) {}
@@ -59,7 +127,9 @@ class BrowserContext::ResourceContext : public content::ResourceContext {
   URLRequestContextGetter* getter_;
 };
 
-BrowserContext::BrowserContext() : resource_context_(new ResourceContext) {
+BrowserContext::BrowserContext()
+    : resource_context_(new ResourceContext),
+      http_server_properties_manager_(nullptr) {
 }
 
 void BrowserContext::Initialize() {
@@ -75,11 +145,20 @@ void BrowserContext::Initialize() {
 
   path_ = path.Append(base::FilePath::FromUTF8Unsafe(GetApplicationName()));
 
-  auto prefs_path = GetPath().Append(FILE_PATH_LITERAL("Preferences"));
   PrefServiceBuilder builder;
-  builder.WithUserFilePrefs(prefs_path,
-      JsonPrefStore::GetTaskRunnerForFile(
-          prefs_path, content::BrowserThread::GetBlockingPool()));
+  if (IsOffTheRecord()) {
+    builder.WithUserPrefs(new InMemoryPrefStore);
+  } else {
+    // Read the file in the background while the rest of startup goes on.
+    auto prefs_path = GetPath().Append(FILE_PATH_LITERAL("Preferences"));
+    pref_store_ = new FilePrefStore(
+        prefs_path,
+        JsonPrefStore::GetTaskRunnerForFile(
+            prefs_path, content::BrowserThread::GetBlockingPool()),
+        GetPrefsCommitInterval());
+    builder.WithUserPrefs(pref_store_.get());
+    builder.WithAsync(true);
+  }
 
   auto registry = make_scoped_refptr(new PrefRegistrySimple);
   RegisterInternalPrefs(registry);
@@ -89,13 +168,42 @@ void BrowserContext::Initialize() {
 }
 
 BrowserContext::~BrowserContext() {
+  if (http_server_properties_manager_)
+    http_server_properties_manager_->ShutdownOnUIThread();
   content::BrowserThread::DeleteSoon(content::BrowserThread::IO,
                                      FROM_HERE,
                                      resource_context_.release());
 }
 
+void BrowserContext::RunWhenPrefsLoaded(const base::Closure& callback) {
+  if (prefs_->GetInitializationStatus() ==
+      PrefService::INITIALIZATION_STATUS_WAITING) {
+    prefs_->AddPrefInitObserver(
+        base::Bind(&RunPrefsLoadedCallback, callback));
+    return;
+  }
+  callback.Run();
+}
+
+PrefWriteStats BrowserContext::GetPrefWriteStats() const {
+  if (!pref_store_)
+    return PrefWriteStats();
+  return pref_store_->write_stats();
+}
+
+DevToolsFileSystemIndexer* BrowserContext::GetDevToolsFileSystemIndexer() {
+  if (!devtools_file_system_indexer_)
+    devtools_file_system_indexer_ = new DevToolsFileSystemIndexer;
+  return devtools_file_system_indexer_.get();
+}
+
+base::TimeDelta BrowserContext::GetPrefsCommitInterval() {
+  return base::TimeDelta::FromSeconds(kDefaultPrefsCommitIntervalSeconds);
+}
+
 void BrowserContext::RegisterInternalPrefs(PrefRegistrySimple* registry) {
   InspectableWebContentsImpl::RegisterPrefs(registry);
+  HttpServerPropertiesManager::RegisterPrefs(registry);
 }
 
 net::URLRequestContextGetter* BrowserContext::CreateRequestContext(
@@ -105,20 +213,205 @@ net::URLRequestContextGetter* BrowserContext::CreateRequestContext(
       content::BrowserThread::IO);
   auto file_loop = content::BrowserThread::UnsafeGetMessageLoopForThread(
       content::BrowserThread::FILE);
+  // A shared network core brings its own proxy service and server
+  // properties.
+  scoped_ptr<net::ProxyConfig> fixed_proxy_config(new net::ProxyConfig);
+  if (network_core_ || !GetFixedProxyConfig(fixed_proxy_config.get()))
+    fixed_proxy_config.reset();
+  scoped_ptr<HttpServerPropertiesManager> http_server_properties_manager;
+  if (!network_core_) {
+    // Owned by the request context, which outlives us on the IO thread.
+    http_server_properties_manager_ =
+        new HttpServerPropertiesManager(prefs_.get());
+    http_server_properties_manager.reset(http_server_properties_manager_);
+  }
+  HttpCacheConfig http_cache_config = GetHttpCacheConfig();
+  if (IsOffTheRecord())
+    http_cache_config.mode = HttpCacheConfig::MODE_MEMORY;
+  HSTSPreloadList hsts_preloads;
+  GetHSTSPreloadList(&hsts_preloads);
   url_request_getter_ = new URLRequestContextGetter(
       GetPath(),
+      IsOffTheRecord(),
+      network_core_.get(),
       io_loop,
       file_loop,
       base::Bind(&BrowserContext::CreateNetworkDelegate, base::Unretained(this)),
+      http_cache_config,
+      fixed_proxy_config.Pass(),
+      http_server_properties_manager.Pass(),
+      hsts_preloads,
       protocol_handlers);
   resource_context_->set_url_request_context_getter(url_request_getter_.get());
   return url_request_getter_.get();
 }
 
+net::URLRequestContextGetter*
+    BrowserContext::CreateRequestContextForStoragePartition(
+        const base::FilePath& partition_path,
+        bool in_memory,
+        content::ProtocolHandlerMap* protocol_handlers) {
+  DCHECK(!partition_getters_.count(partition_path));
+  // Partitions are built on top of the default partition's network stack.
+  GetRequestContext();
+  DCHECK(url_request_getter_);
+
+  in_memory = in_memory || IsOffTheRecord();
+  HttpCacheConfig http_cache_config =
+      GetHttpCacheConfigForStoragePartition(partition_path);
+  if (in_memory)
+    http_cache_config.mode = HttpCacheConfig::MODE_MEMORY;
+  auto getter = new IsolatedURLRequestContextGetter(
+      url_request_getter_.get(),
+      partition_path,
+      in_memory,
+      http_cache_config,
+      protocol_handlers);
+  partition_getters_[partition_path] = getter;
+  return getter;
+}
+
+void BrowserContext::ShareNetworkCoreWith(BrowserContext* other) {
+  DCHECK(!url_request_getter_);
+  DCHECK_NE(this, other);
+  // The session keeps state of the context that owns it, so an off the
+  // record context must not share one with a regular context.
+  if (IsOffTheRecord() != other->IsOffTheRecord()) {
+    NOTREACHED() << "Can't share a network core across off the record "
+                 << "and regular contexts";
+    return;
+  }
+
+  // Attach to the context that actually owns the core, so contexts don't
+  // end up chained to each other.
+  if (other->network_core_) {
+    network_core_ = other->network_core_;
+    return;
+  }
+  other->GetRequestContext();
+  DCHECK(other->url_request_getter_);
+  network_core_ = other->url_request_getter_;
+}
+
+void BrowserContext::WarmUpRequestContext() {
+  // Creating the default storage partition calls back into
+  // CreateRequestContext().
+  GetRequestContext();
+  DCHECK(url_request_getter_);
+  content::BrowserThread::PostTask(
+      content::BrowserThread::IO,
+      FROM_HERE,
+      base::Bind(&URLRequestContextGetter::WarmUp, url_request_getter_));
+}
+
 scoped_ptr<NetworkDelegate> BrowserContext::CreateNetworkDelegate() {
   return make_scoped_ptr(new NetworkDelegate).Pass();
 }
 
+HttpCacheConfig BrowserContext::GetHttpCacheConfig() {
+  return HttpCacheConfig();
+}
+
+HttpCacheConfig BrowserContext::GetHttpCacheConfigForStoragePartition(
+    const base::FilePath& partition_path) {
+  HttpCacheConfig config = GetHttpCacheConfig();
+  if (config.mode == HttpCacheConfig::MODE_TIERED)
+    config.mode = HttpCacheConfig::MODE_DISK;
+  return config;
+}
+
+HttpCacheConfig BrowserContext::GetMediaHttpCacheConfig() {
+  HttpCacheConfig config;
+  config.disk_cache_type = net::MEDIA_CACHE;
+  return config;
+}
+
+void BrowserContext::GetHttpCacheStats(
+    const base::Callback<void(const HttpCacheStats&)>& callback) {
+  DCHECK(url_request_getter_);
+  base::PostTaskAndReplyWithResult(
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::IO),
+      FROM_HERE,
+      base::Bind(&GetHttpCacheStatsOnIOThread, url_request_getter_),
+      callback);
+}
+
+void BrowserContext::GetMediaHttpCacheStats(
+    const base::Callback<void(const HttpCacheStats&)>& callback) {
+  GetMediaRequestContext();
+  DCHECK(media_request_getter_);
+  base::PostTaskAndReplyWithResult(
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::IO),
+      FROM_HERE,
+      base::Bind(&GetMediaHttpCacheStatsOnIOThread, media_request_getter_),
+      callback);
+}
+
+void BrowserContext::GetProxyResolverStats(
+    const base::Callback<void(const ProxyResolverStats&)>& callback) {
+  DCHECK(url_request_getter_);
+  base::PostTaskAndReplyWithResult(
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::IO),
+      FROM_HERE,
+      base::Bind(&GetProxyResolverStatsOnIOThread, url_request_getter_),
+      callback);
+}
+
+void BrowserContext::GetServerBoundCertStats(
+    const base::Callback<void(const ServerBoundCertStats&)>& callback) {
+  DCHECK(url_request_getter_);
+  base::PostTaskAndReplyWithResult(
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::IO),
+      FROM_HERE,
+      base::Bind(&GetServerBoundCertStatsOnIOThread, url_request_getter_),
+      callback);
+}
+
+void BrowserContext::GetNetworkStats(
+    const base::Callback<void(const NetworkStats&)>& callback) {
+  DCHECK(url_request_getter_);
+  base::PostTaskAndReplyWithResult(
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::IO),
+      FROM_HERE,
+      base::Bind(&GetNetworkStatsOnIOThread, url_request_getter_),
+      callback);
+}
+
+void BrowserContext::GetRequestSchedulerStats(
+    const base::Callback<void(const RequestSchedulerStats&)>& callback) {
+  DCHECK(url_request_getter_);
+  base::PostTaskAndReplyWithResult(
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::IO),
+      FROM_HERE,
+      base::Bind(&GetRequestSchedulerStatsOnIOThread, url_request_getter_),
+      callback);
+}
+
+void BrowserContext::SetRequestSchedulerConfig(
+    const RequestSchedulerConfig& config) {
+  DCHECK(url_request_getter_);
+  content::BrowserThread::PostTask(
+      content::BrowserThread::IO,
+      FROM_HERE,
+      base::Bind(&SetRequestSchedulerConfigOnIOThread,
+                 url_request_getter_,
+                 config));
+}
+
+void BrowserContext::SetURLRules(const URLRuleList& rules) {
+  DCHECK(url_request_getter_);
+  content::BrowserThread::PostTask(
+      content::BrowserThread::IO,
+      FROM_HERE,
+      base::Bind(&SetURLRulesOnIOThread, url_request_getter_, rules));
+}
+
 base::FilePath BrowserContext::GetPath() const {
   return path_;
 }
@@ -133,24 +426,51 @@ net::URLRequestContextGetter* BrowserContext::GetRequestContext() {
 
 net::URLRequestContextGetter* BrowserContext::GetRequestContextForRenderProcess(
     int renderer_child_id) {
-  return GetRequestContext();
+  auto host = content::RenderProcessHost::FromID(renderer_child_id);
+  return host->GetStoragePartition()->GetURLRequestContext();
 }
 
 net::URLRequestContextGetter* BrowserContext::GetMediaRequestContext() {
-  return GetRequestContext();
+  if (!media_request_getter_) {
+    HttpCacheConfig config = GetMediaHttpCacheConfig();
+    if (IsOffTheRecord())
+      config.mode = HttpCacheConfig::MODE_MEMORY;
+    media_request_getter_ = new MediaURLRequestContextGetter(
+        GetRequestContext(),
+        GetPath().Append(FILE_PATH_LITERAL("Media Cache")),
+        config);
+  }
+  return media_request_getter_.get();
 }
 
 net::URLRequestContextGetter*
     BrowserContext::GetMediaRequestContextForRenderProcess(
         int renderer_child_id) {
-  return GetRequestContext();
+  auto host = content::RenderProcessHost::FromID(renderer_child_id);
+  return host->GetStoragePartition()->GetMediaURLRequestContext();
 }
 
 net::URLRequestContextGetter*
     BrowserContext::GetMediaRequestContextForStoragePartition(
         const base::FilePath& partition_path,
         bool in_memory) {
-  return GetRequestContext();
+  auto media_it = partition_media_getters_.find(partition_path);
+  if (media_it != partition_media_getters_.end())
+    return media_it->second.get();
+
+  auto it = partition_getters_.find(partition_path);
+  if (it == partition_getters_.end())
+    return GetMediaRequestContext();
+
+  HttpCacheConfig config = GetMediaHttpCacheConfig();
+  if (in_memory || IsOffTheRecord())
+    config.mode = HttpCacheConfig::MODE_MEMORY;
+  auto getter = new MediaURLRequestContextGetter(
+      it->second.get(),
+      partition_path.Append(FILE_PATH_LITERAL("Media Cache")),
+      config);
+  partition_media_getters_[partition_path] = getter;
+  return getter;
 }
 
 void BrowserContext::RequestMIDISysExPermission(
@@ -5,17 +5,36 @@
 #ifndef BRIGHTRAY_BROWSER_BROWSER_CONTEXT_H_
 #define BRIGHTRAY_BROWSER_BROWSER_CONTEXT_H_
 
+#include <map>
+
+#include "browser/file_pref_store.h"
+#include "browser/net/http_cache_config.h"
+#include "browser/net/request_scheduler.h"
+#include "browser/net/transport_security_persister.h"
+#include "browser/net/url_rule_set.h"
+
 #include "content/public/browser/browser_context.h"
 #include "content/public/browser/content_browser_client.h"
 
 class PrefRegistrySimple;
 class PrefService;
 
+namespace net {
+class ProxyConfig;
+}
+
 namespace brightray {
 
+class DevToolsFileSystemIndexer;
 class DownloadManagerDelegate;
+class HttpServerPropertiesManager;
+class IsolatedURLRequestContextGetter;
+class MediaURLRequestContextGetter;
 class NetworkDelegate;
 class URLRequestContextGetter;
+struct NetworkStats;
+struct ProxyResolverStats;
+struct ServerBoundCertStats;
 
 class BrowserContext : public content::BrowserContext {
  public:
@@ -27,16 +46,130 @@ class BrowserContext : public content::BrowserContext {
   net::URLRequestContextGetter* CreateRequestContext(
       content::ProtocolHandlerMap*);
 
+  // Creates the request context of a storage partition other than the
+  // default one. Partitions are assigned by overriding
+  // ContentBrowserClient::GetStoragePartitionConfigForSite(); each one gets
+  // its own cookies and cache and shares the rest of the network stack with
+  // the default partition.
+  net::URLRequestContextGetter* CreateRequestContextForStoragePartition(
+      const base::FilePath& partition_path,
+      bool in_memory,
+      content::ProtocolHandlerMap*);
+
+  // Preferences are read from disk asynchronously. Until they have been
+  // loaded, every preference has its default value.
   PrefService* prefs() { return prefs_.get(); }
 
+  // Runs |callback| once preferences have been loaded, or right away if they
+  // already are.
+  void RunWhenPrefsLoaded(const base::Closure& callback);
+
+  // Returns how often and how much the preferences file has been written.
+  PrefWriteStats GetPrefWriteStats() const;
+
+  // The index of the folders added to DevTools workspaces, shared by every
+  // DevTools frontend of this context. Created on first use.
+  DevToolsFileSystemIndexer* GetDevToolsFileSystemIndexer();
+
+  // Makes this context share |other|'s host resolver, cert verifier, proxy
+  // service, SSL config, HTTP server properties, server-bound certs and
+  // HttpNetworkSession, so DNS and cert verification caches and idle sockets
+  // are pooled between them. Cookies, caches and protocol handlers stay
+  // separate, and GetFixedProxyConfig() is ignored in favor of |other|'s
+  // proxy settings. Requests use this context's HSTS state and network
+  // delegate, but the shared session uses |other|'s for connections. Must
+  // be called before this context's request context is created, e.g. right
+  // after Initialize(). Both contexts must be off the record or both not;
+  // otherwise the call is refused. Opt-in; by default every context has its
+  // own stack.
+  void ShareNetworkCoreWith(BrowserContext* other);
+
+  // Creates the request context now and builds the network stack on the IO
+  // thread, instead of waiting for the first request to need it.
+  void WarmUpRequestContext();
+
+  // Fetches the HTTP cache lookup counters from the IO thread and runs
+  // |callback| with them on the UI thread.
+  void GetHttpCacheStats(
+      const base::Callback<void(const HttpCacheStats&)>& callback);
+
+  // Same as above for the default partition's media cache.
+  void GetMediaHttpCacheStats(
+      const base::Callback<void(const HttpCacheStats&)>& callback);
+
+  // Same as above for the PAC lookup cache.
+  void GetProxyResolverStats(
+      const base::Callback<void(const ProxyResolverStats&)>& callback);
+
+  // Same as above for server-bound (channel ID) certificates.
+  void GetServerBoundCertStats(
+      const base::Callback<void(const ServerBoundCertStats&)>& callback);
+
+  // Same as above for the per-origin and per-render-view request timings
+  // and byte counts.
+  void GetNetworkStats(
+      const base::Callback<void(const NetworkStats&)>& callback);
+
+  // Same as above for the request scheduler's queues.
+  void GetRequestSchedulerStats(
+      const base::Callback<void(const RequestSchedulerStats&)>& callback);
+
+  // Limits how many requests may run at once, globally and per origin.
+  // Requests over the limits wait in per-class queues, and interactive ones
+  // are always started first. Disabled by default.
+  void SetRequestSchedulerConfig(const RequestSchedulerConfig& config);
+
+  // Replaces the rules that block, redirect or add headers to requests. The
+  // rules are compiled off the IO thread, so requests aren't held up while a
+  // large list is being loaded.
+  void SetURLRules(const URLRuleList& rules);
+
  protected:
   // Subclasses should override this to register custom preferences.
   virtual void RegisterPrefs(PrefRegistrySimple* pref_registry) {}
 
+  // Subclasses should override this to change how long preference changes
+  // are batched before the preferences file is rewritten.
+  virtual base::TimeDelta GetPrefsCommitInterval();
+
   // Subclasses should override this to provide a custom NetworkDelegate
   // implementation.
   virtual scoped_ptr<NetworkDelegate> CreateNetworkDelegate();
 
+  // Subclasses should override this to change where the HTTP cache keeps its
+  // entries (in memory, on disk, or both) and how large it may grow.
+  virtual HttpCacheConfig GetHttpCacheConfig();
+
+  // Subclasses should override this to change the HTTP cache of the storage
+  // partition at |partition_path|. The default is GetHttpCacheConfig()
+  // without the memory tier, so that each partition only costs memory while
+  // it is being used. In-memory partitions always use MODE_MEMORY.
+  virtual HttpCacheConfig GetHttpCacheConfigForStoragePartition(
+      const base::FilePath& partition_path);
+
+  // Subclasses should override this to change the separate HTTP cache that
+  // audio and video are fetched through, in <profile>/Media Cache (or the
+  // partition's directory). The default is a disk-only MEDIA_CACHE sized by
+  // the backend. Off-the-record contexts always use MODE_MEMORY.
+  virtual HttpCacheConfig GetMediaHttpCacheConfig();
+
+  // Subclasses can override this to fill in |config| and return true to use a
+  // fixed proxy configuration instead of the system one. A configuration that
+  // doesn't use PAC or WPAD (e.g., net::ProxyConfig::CreateDirect()) skips
+  // both reading the system settings and creating a PAC resolver.
+  virtual bool GetFixedProxyConfig(net::ProxyConfig* config) { return false; }
+
+  // Subclasses can override this to add hosts that must always be loaded
+  // over HTTPS. They are applied when the request context is created, before
+  // any request is made.
+  virtual void GetHSTSPreloadList(HSTSPreloadList* preloads) {}
+
+  // Subclasses should override this to return true for short-lived sessions
+  // that must not leave anything on disk. Preferences, cookies, the HTTP
+  // cache, server-bound certs and HSTS state are then kept in memory only,
+  // and nothing under GetPath() is created or read.
+  virtual bool IsOffTheRecord() const OVERRIDE;
+
   virtual base::FilePath GetPath() const OVERRIDE;
 
  private:
@@ -44,7 +177,6 @@ class BrowserContext : public content::BrowserContext {
 
   void RegisterInternalPrefs(PrefRegistrySimple* pref_registry);
 
-  virtual bool IsOffTheRecord() const OVERRIDE;
   virtual net::URLRequestContextGetter* GetRequestContext() OVERRIDE;
   virtual net::URLRequestContextGetter* GetRequestContextForRenderProcess(
       int renderer_child_id);
@@ -70,8 +202,21 @@ class BrowserContext : public content::BrowserContext {
   base::FilePath path_;
   scoped_ptr<ResourceContext> resource_context_;
   scoped_refptr<URLRequestContextGetter> url_request_getter_;
+  // The context whose network stack |url_request_getter_| is built on, if
+  // any.
+  scoped_refptr<URLRequestContextGetter> network_core_;
+  scoped_refptr<MediaURLRequestContextGetter> media_request_getter_;
+  std::map<base::FilePath, scoped_refptr<IsolatedURLRequestContextGetter> >
+      partition_getters_;
+  std::map<base::FilePath, scoped_refptr<MediaURLRequestContextGetter> >
+      partition_media_getters_;
   scoped_ptr<PrefService> prefs_;
+  // Null for off-the-record contexts.
+  scoped_refptr<FilePrefStore> pref_store_;
+  // Owned by |url_request_getter_|.
+  HttpServerPropertiesManager* http_server_properties_manager_;
   scoped_ptr<DownloadManagerDelegate> download_manager_delegate_;
+  scoped_refptr<DevToolsFileSystemIndexer> devtools_file_system_indexer_;
 
   DISALLOW_COPY_AND_ASSIGN(BrowserContext);
 };
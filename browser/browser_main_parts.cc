@@ -6,6 +6,9 @@
 
 #include "browser/browser_context.h"
 #include "browser/web_ui_controller_factory.h"
+#include "common/startup_timeline.h"
+
+#include "content/public/browser/browser_thread.h"
 #include "net/proxy/proxy_resolver_v8.h"
 
 namespace brightray {
@@ -17,9 +20,26 @@ BrowserMainParts::~BrowserMainParts() {
 }
 
 void BrowserMainParts::PreMainMessageLoopRun() {
-  browser_context_.reset(CreateBrowserContext());
-  browser_context_->Initialize();
+  InitializeBrowserContext();
+
+  StartupTimeline::ReachMilestone(
+      StartupTimeline::MAIN_MESSAGE_LOOP_READY,
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::FILE));
+}
+
+void BrowserMainParts::InitializeBrowserContext() {
+  ScopedStartupPhase phase("BrowserMainParts::PreMainMessageLoopRun");
+
+  {
+    ScopedStartupPhase context_phase("BrowserContext::Initialize");
+    browser_context_.reset(CreateBrowserContext());
+    browser_context_->Initialize();
+  }
+  if (ShouldWarmUpRequestContext())
+    browser_context_->WarmUpRequestContext();
 
+  ScopedStartupPhase factory_phase("WebUIControllerFactory::RegisterFactory");
   web_ui_controller_factory_.reset(
       new WebUIControllerFactory(browser_context_.get()));
   content::WebUIControllerFactory::RegisterFactory(
@@ -27,10 +47,15 @@ void BrowserMainParts::PreMainMessageLoopRun() {
 }
 
 void BrowserMainParts::PostMainMessageLoopRun() {
+  // In case no request context was ever created.
+  StartupTimeline::Finish(
+      content::BrowserThread::GetMessageLoopProxyForThread(
+          content::BrowserThread::FILE));
   browser_context_.reset();
 }
 
 int BrowserMainParts::PreCreateThreads() {
+  ScopedStartupPhase phase("BrowserMainParts::PreCreateThreads");
 #if defined(OS_WIN)
   net::ProxyResolverV8::CreateIsolate();
 #else
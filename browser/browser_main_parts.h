@@ -26,6 +26,11 @@ class BrowserMainParts : public content::BrowserMainParts {
   // implementation. The caller takes ownership of the returned object.
   virtual BrowserContext* CreateBrowserContext();
 
+  // Subclasses can override this to return true to have the network stack
+  // built on the IO thread during startup, so the first navigation doesn't
+  // have to wait for it.
+  virtual bool ShouldWarmUpRequestContext() { return false; }
+
 #if defined(OS_MACOSX)
   virtual void PreEarlyInitialization() OVERRIDE;
   virtual void PreMainMessageLoopStart() OVERRIDE;
@@ -36,6 +41,9 @@ class BrowserMainParts : public content::BrowserMainParts {
   virtual int PreCreateThreads() OVERRIDE;
 
  private:
+  // The body of PreMainMessageLoopRun(), timed as one startup phase.
+  void InitializeBrowserContext();
+
   scoped_ptr<BrowserContext> browser_context_;
   scoped_ptr<WebUIControllerFactory> web_ui_controller_factory_;
 
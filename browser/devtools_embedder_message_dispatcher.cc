@@ -4,7 +4,8 @@
 
 #include "browser/devtools_embedder_message_dispatcher.h"
 
-#include "base/bind.h"
+#include <algorithm>
+
 #include "base/json/json_reader.h"
 #include "base/values.h"
 
@@ -27,14 +28,26 @@ bool GetValue(const base::ListValue& list, int pos, bool& value) {
   return list.GetBoolean(pos, &value);
 }
 
+// How each parameter type is stored while a message is handled, and how
+// the stored value is passed to the delegate. A pointer parameter gets the
+// storage itself, so the delegate can take the value over instead of
+// copying it.
 template <typename T>
 struct StorageTraits {
   typedef T StorageType;
+  static T Pass(T& value) { return value; }
 };
 
 template <typename T>
 struct StorageTraits<const T&> {
   typedef T StorageType;
+  static const T& Pass(T& value) { return value; }
+};
+
+template <typename T>
+struct StorageTraits<T*> {
+  typedef T StorageType;
+  static T* Pass(T& value) { return &value; }
 };
 
 template <class A>
@@ -46,7 +59,7 @@ class Argument {
     valid_ = GetValue(list, pos, value_);
   }
 
-  ValueType value() const { return value_; }
+  A value() { return StorageTraits<A>::Pass(value_); }
   bool valid() const { return valid_; }
 
  private:
@@ -54,27 +67,31 @@ class Argument {
   bool valid_;
 };
 
-bool ParseAndHandle0(const base::Callback<void(void)>& handler,
-                     const base::ListValue& list) {
-  handler.Run();
+// Each handler checks and unpacks the params for one Delegate method and
+// calls it. They're plain functions, so the method table below can be a
+// constant array rather than a map of callbacks built per dispatcher.
+typedef DevToolsEmbedderMessageDispatcher::Delegate Delegate;
+typedef bool (*Handler)(Delegate* delegate, const base::ListValue& list);
+
+template <void (Delegate::*method)()>
+bool ParseAndHandle0(Delegate* delegate, const base::ListValue& list) {
+  (delegate->*method)();
   return true;
 }
 
-template <class A1>
-bool ParseAndHandle1(const base::Callback<void(A1)>& handler,
-                     const base::ListValue& list) {
+template <class A1, void (Delegate::*method)(A1)>
+bool ParseAndHandle1(Delegate* delegate, const base::ListValue& list) {
   if (list.GetSize() != 1)
     return false;
   Argument<A1> arg1(list, 0);
   if (!arg1.valid())
     return false;
-  handler.Run(arg1.value());
+  (delegate->*method)(arg1.value());
   return true;
 }
 
-template <class A1, class A2>
-bool ParseAndHandle2(const base::Callback<void(A1, A2)>& handler,
-                     const base::ListValue& list) {
+template <class A1, class A2, void (Delegate::*method)(A1, A2)>
+bool ParseAndHandle2(Delegate* delegate, const base::ListValue& list) {
   if (list.GetSize() != 2)
     return false;
   Argument<A1> arg1(list, 0);
@@ -83,13 +100,12 @@ bool ParseAndHandle2(const base::Callback<void(A1, A2)>& handler,
   Argument<A2> arg2(list, 1);
   if (!arg2.valid())
     return false;
-  handler.Run(arg1.value(), arg2.value());
+  (delegate->*method)(arg1.value(), arg2.value());
   return true;
 }
 
-template <class A1, class A2, class A3>
-bool ParseAndHandle3(const base::Callback<void(A1, A2, A3)>& handler,
-                     const base::ListValue& list) {
+template <class A1, class A2, class A3, void (Delegate::*method)(A1, A2, A3)>
+bool ParseAndHandle3(Delegate* delegate, const base::ListValue& list) {
   if (list.GetSize() != 3)
     return false;
   Argument<A1> arg1(list, 0);
@@ -101,108 +117,115 @@ bool ParseAndHandle3(const base::Callback<void(A1, A2, A3)>& handler,
   Argument<A3> arg3(list, 2);
   if (!arg3.valid())
     return false;
-  handler.Run(arg1.value(), arg2.value(), arg3.value());
+  (delegate->*method)(arg1.value(), arg2.value(), arg3.value());
   return true;
 }
 
-typedef base::Callback<bool (const base::ListValue&)> ListValueParser;
-
-ListValueParser BindToListParser(const base::Callback<void()>& handler) {
-  return base::Bind(&ParseAndHandle0, handler);
-}
+struct HandlerEntry {
+  const char* method;
+  Handler handler;
+};
 
-template <class A1>
-ListValueParser BindToListParser(const base::Callback<void(A1)>& handler) {
-  return base::Bind(&ParseAndHandle1<A1>, handler);
-}
+// Must stay sorted by method name; FindHandler() does a binary search.
+const HandlerEntry kHandlers[] = {
+  { "addFileSystem", &ParseAndHandle0<&Delegate::AddFileSystem> },
+  { "append",
+    &ParseAndHandle2<const std::string&, std::string*,
+                     &Delegate::AppendToFile> },
+  { "bringToFront", &ParseAndHandle0<&Delegate::ActivateWindow> },
+  { "closeWindow", &ParseAndHandle0<&Delegate::CloseWindow> },
+  { "indexPath",
+    &ParseAndHandle2<int, const std::string&, &Delegate::IndexPath> },
+  { "moveWindowBy", &ParseAndHandle2<int, int, &Delegate::MoveWindow> },
+  { "openInNewTab",
+    &ParseAndHandle1<const std::string&, &Delegate::OpenInNewTab> },
+  { "removeFileSystem",
+    &ParseAndHandle1<const std::string&, &Delegate::RemoveFileSystem> },
+  { "requestFileSystems", &ParseAndHandle0<&Delegate::RequestFileSystems> },
+  { "requestSetDockSide",
+    &ParseAndHandle1<const std::string&, &Delegate::SetDockSide> },
+  { "save",
+    &ParseAndHandle3<const std::string&, std::string*, bool,
+                     &Delegate::SaveToFile> },
+  { "searchInPath",
+    &ParseAndHandle3<int, const std::string&, const std::string&,
+                     &Delegate::SearchInPath> },
+  { "stopIndexing", &ParseAndHandle1<int, &Delegate::StopIndexing> },
+};
 
-template <class A1, class A2>
-ListValueParser BindToListParser(const base::Callback<void(A1, A2)>& handler) {
-  return base::Bind(&ParseAndHandle2<A1, A2>, handler);
+bool MethodLessThan(const HandlerEntry& entry, const std::string& method) {
+  return method.compare(entry.method) > 0;
 }
 
-template <class A1, class A2, class A3>
-ListValueParser BindToListParser(
-    const base::Callback<void(A1, A2, A3)>& handler) {
-  return base::Bind(&ParseAndHandle3<A1, A2, A3>, handler);
+Handler FindHandler(const std::string& method) {
+  const HandlerEntry* end = kHandlers + arraysize(kHandlers);
+  const HandlerEntry* entry =
+      std::lower_bound(kHandlers, end, method, &MethodLessThan);
+  if (entry == end || method != entry->method)
+    return NULL;
+  return entry->handler;
 }
 
 }  // namespace
 
 DevToolsEmbedderMessageDispatcher::DevToolsEmbedderMessageDispatcher(
-    Delegate* delegate) {
-  RegisterHandler("bringToFront",
-      BindToListParser(base::Bind(&Delegate::ActivateWindow,
-                                  base::Unretained(delegate))));
-  RegisterHandler("closeWindow",
-      BindToListParser(base::Bind(&Delegate::CloseWindow,
-                                  base::Unretained(delegate))));
-  RegisterHandler("moveWindowBy",
-      BindToListParser(base::Bind(&Delegate::MoveWindow,
-                                  base::Unretained(delegate))));
-  RegisterHandler("requestSetDockSide",
-      BindToListParser(base::Bind(&Delegate::SetDockSide,
-                                  base::Unretained(delegate))));
-  RegisterHandler("openInNewTab",
-      BindToListParser(base::Bind(&Delegate::OpenInNewTab,
-                                  base::Unretained(delegate))));
-  RegisterHandler("save",
-      BindToListParser(base::Bind(&Delegate::SaveToFile,
-                                  base::Unretained(delegate))));
-  RegisterHandler("append",
-      BindToListParser(base::Bind(&Delegate::AppendToFile,
-                                  base::Unretained(delegate))));
-  RegisterHandler("requestFileSystems",
-      BindToListParser(base::Bind(&Delegate::RequestFileSystems,
-                                  base::Unretained(delegate))));
-  RegisterHandler("addFileSystem",
-      BindToListParser(base::Bind(&Delegate::AddFileSystem,
-                                  base::Unretained(delegate))));
-  RegisterHandler("removeFileSystem",
-      BindToListParser(base::Bind(&Delegate::RemoveFileSystem,
-                                  base::Unretained(delegate))));
-  RegisterHandler("indexPath",
-      BindToListParser(base::Bind(&Delegate::IndexPath,
-                                  base::Unretained(delegate))));
-  RegisterHandler("stopIndexing",
-      BindToListParser(base::Bind(&Delegate::StopIndexing,
-                                  base::Unretained(delegate))));
-  RegisterHandler("searchInPath",
-      BindToListParser(base::Bind(&Delegate::SearchInPath,
-                                  base::Unretained(delegate))));
+    Delegate* delegate)
+    : delegate_(delegate),
+      weak_factory_(this) {
 }
 
 DevToolsEmbedderMessageDispatcher::~DevToolsEmbedderMessageDispatcher() {}
 
 void DevToolsEmbedderMessageDispatcher::Dispatch(const std::string& message) {
-  std::string method;
-  base::ListValue empty_params;
-  base::ListValue* params = &empty_params;
+  scoped_ptr<base::Value> parsed_message(base::JSONReader::Read(message));
+  if (!parsed_message) {
+    LOG(ERROR) << "Cannot parse frontend host message: " << message;
+    return;
+  }
+
+  // A batch is an array of messages, handled in order.
+  base::ListValue* batch;
+  if (parsed_message->GetAsList(&batch)) {
+    auto weak_this = weak_factory_.GetWeakPtr();
+    for (size_t i = 0; i < batch->GetSize() && weak_this; ++i) {
+      base::DictionaryValue* dict;
+      if (!batch->GetDictionary(i, &dict)) {
+        LOG(ERROR) << "Cannot parse frontend host message: " << message;
+        continue;
+      }
+      DispatchMessage(*dict, message);
+    }
+    return;
+  }
 
   base::DictionaryValue* dict;
-  scoped_ptr<base::Value> parsed_message(base::JSONReader::Read(message));
-  if (!parsed_message ||
-      !parsed_message->GetAsDictionary(&dict) ||
-      !dict->GetString(kFrontendHostMethod, &method) ||
-      (dict->HasKey(kFrontendHostParams) &&
-          !dict->GetList(kFrontendHostParams, &params))) {
+  if (!parsed_message->GetAsDictionary(&dict)) {
     LOG(ERROR) << "Cannot parse frontend host message: " << message;
     return;
   }
+  DispatchMessage(*dict, message);
+}
 
-  HandlerMap::iterator it = handlers_.find(method);
-  if (it == handlers_.end()) {
+void DevToolsEmbedderMessageDispatcher::DispatchMessage(
+    const base::DictionaryValue& dict, const std::string& message) {
+  std::string method;
+  base::ListValue empty_params;
+  const base::ListValue* params = &empty_params;
+  if (!dict.GetString(kFrontendHostMethod, &method) ||
+      (dict.HasKey(kFrontendHostParams) &&
+          !dict.GetList(kFrontendHostParams, &params))) {
+    LOG(ERROR) << "Cannot parse frontend host message: " << message;
+    return;
+  }
+
+  Handler handler = FindHandler(method);
+  if (!handler) {
     LOG(ERROR) << "Unsupported frontend host method: " << message;
     return;
   }
 
-  if (!it->second.Run(*params))
+  if (!handler(delegate_, *params))
     LOG(ERROR) << "Invalid frontend host message parameters: " << message;
 }
 
-void DevToolsEmbedderMessageDispatcher::RegisterHandler(
-    const std::string& method, const Handler& handler) {
-  handlers_[method] = handler;
-}
-
 }  // namespace brightray
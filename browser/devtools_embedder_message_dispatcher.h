@@ -5,13 +5,13 @@
 #ifndef BRIGHTRAY_BROWSER_DEVTOOLS_EMBEDDER_MESSAGE_DISPATCHER_H_
 #define BRIGHTRAY_BROWSER_DEVTOOLS_EMBEDDER_MESSAGE_DISPATCHER_H_
 
-#include <map>
 #include <string>
 
-#include "base/callback.h"
+#include "base/basictypes.h"
+#include "base/memory/weak_ptr.h"
 
 namespace base {
-class ListValue;
+class DictionaryValue;
 }
 
 namespace brightray {
@@ -21,6 +21,9 @@ namespace brightray {
  * isolated renderer (on chrome-devtools://) to the embedder in the browser.
  *
  * The messages are sent via InspectorFrontendHost.sendMessageToEmbedder method.
+ * A message is either a single {method, params} object or an array of them,
+ * which are dispatched in order. If a handler destroys the dispatcher, e.g.
+ * because it closed the frontend, the rest of the batch is dropped.
  */
 class DevToolsEmbedderMessageDispatcher {
  public:
@@ -33,11 +36,13 @@ class DevToolsEmbedderMessageDispatcher {
     virtual void MoveWindow(int x, int y) = 0;
     virtual void SetDockSide(const std::string& side) = 0;
     virtual void OpenInNewTab(const std::string& url) = 0;
+    // |content| may be swapped out rather than copied, since save and
+    // append messages carry the file's data.
     virtual void SaveToFile(const std::string& url,
-                            const std::string& content,
+                            std::string* content,
                             bool save_as) = 0;
     virtual void AppendToFile(const std::string& url,
-                              const std::string& content) = 0;
+                              std::string* content) = 0;
     virtual void RequestFileSystems() = 0;
     virtual void AddFileSystem() = 0;
     virtual void RemoveFileSystem(const std::string& file_system_path) = 0;
@@ -56,11 +61,15 @@ class DevToolsEmbedderMessageDispatcher {
   void Dispatch(const std::string& message);
 
  private:
-  typedef base::Callback<bool (const base::ListValue&)> Handler;
-  void RegisterHandler(const std::string& method, const Handler& handler);
+  // |message| is the raw message |dict| came from, for error reporting.
+  void DispatchMessage(const base::DictionaryValue& dict,
+                       const std::string& message);
 
-  typedef std::map<std::string, Handler> HandlerMap;
-  HandlerMap handlers_;
+  Delegate* delegate_;
+
+  base::WeakPtrFactory<DevToolsEmbedderMessageDispatcher> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(DevToolsEmbedderMessageDispatcher);
 };
 
 }  // namespace brightray
@@ -0,0 +1,472 @@
+#include "browser/devtools_file_system_indexer.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/file_path_watcher.h"
+#include "base/platform_file.h"
+#include "base/strings/string_util.h"
+#include "base/threading/sequenced_worker_pool.h"
+
+using content::BrowserThread;
+
+namespace brightray {
+
+namespace {
+
+// How many files a blocking pool thread reads before handing their trigrams
+// to the index sequence.
+const size_t kFilesPerBatch = 64;
+
+// Larger files aren't read, so they're never search results.
+const int64 kMaxFileSize = 10 * 1024 * 1024;
+
+// Files with a NUL byte near the start are taken to be binary, and aren't
+// indexed either.
+const size_t kBinarySniffLength = 4096;
+
+// Changes often come in bursts, e.g. when switching branches.
+const int kRescanDelayMs = 500;
+
+uint32 Trigram(const char* bytes) {
+  return static_cast<uint32>(
+      static_cast<uint8>(base::ToLowerASCII(bytes[0])) << 16 |
+      static_cast<uint8>(base::ToLowerASCII(bytes[1])) << 8 |
+      static_cast<uint8>(base::ToLowerASCII(bytes[2])));
+}
+
+// Fills |trigrams| with the distinct trigrams of |text|, sorted.
+void ExtractTrigrams(const std::string& text, std::vector<uint32>* trigrams) {
+  if (text.size() < 3)
+    return;
+  trigrams->reserve(text.size() - 2);
+  for (size_t i = 0; i + 2 < text.size(); ++i)
+    trigrams->push_back(Trigram(text.data() + i));
+  std::sort(trigrams->begin(), trigrams->end());
+  trigrams->erase(std::unique(trigrams->begin(), trigrams->end()),
+                  trigrams->end());
+}
+
+bool IsBinary(const std::string& contents) {
+  size_t length = std::min(contents.size(), kBinarySniffLength);
+  return std::find(contents.begin(), contents.begin() + length, '\0') !=
+      contents.begin() + length;
+}
+
+// Skips .git, .svn and the like.
+bool IsHidden(const base::FilePath& path) {
+  auto name = path.BaseName().value();
+  return !name.empty() && name[0] == '.';
+}
+
+// Returns true if |path| is |root| or inside it.
+bool IsInside(const base::FilePath& root, const base::FilePath& path) {
+  return root == path || root.IsParent(path);
+}
+
+}  // namespace
+
+DevToolsFileSystemIndexer::IndexingJob::IndexingJob(
+    const base::FilePath& path,
+    const TotalWorkCallback& total_work_callback,
+    const WorkedCallback& worked_callback,
+    const DoneCallback& done_callback)
+    : path_(path),
+      total_work_callback_(total_work_callback),
+      worked_callback_(worked_callback),
+      done_callback_(done_callback),
+      pending_batches_(0) {
+}
+
+DevToolsFileSystemIndexer::IndexingJob::~IndexingJob() {
+}
+
+void DevToolsFileSystemIndexer::IndexingJob::Stop() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  stopped_.Set();
+}
+
+void DevToolsFileSystemIndexer::IndexingJob::ReportTotalWork(int total_work) {
+  if (!total_work_callback_.is_null())
+    RunUnlessStopped(base::Bind(total_work_callback_, total_work));
+}
+
+void DevToolsFileSystemIndexer::IndexingJob::ReportWorked(int worked) {
+  if (!worked_callback_.is_null())
+    RunUnlessStopped(base::Bind(worked_callback_, worked));
+}
+
+void DevToolsFileSystemIndexer::IndexingJob::ReportDone() {
+  if (!done_callback_.is_null())
+    RunUnlessStopped(done_callback_);
+}
+
+void DevToolsFileSystemIndexer::IndexingJob::RunUnlessStopped(
+    const base::Closure& closure) {
+  if (!BrowserThread::CurrentlyOn(BrowserThread::UI)) {
+    BrowserThread::PostTask(
+        BrowserThread::UI, FROM_HERE,
+        base::Bind(&IndexingJob::RunUnlessStopped, this, closure));
+    return;
+  }
+  if (!stopped_.IsSet())
+    closure.Run();
+}
+
+DevToolsFileSystemIndexer::DevToolsFileSystemIndexer()
+    : removed_files_(0) {
+  auto pool = BrowserThread::GetBlockingPool();
+  index_runner_ = pool->GetSequencedTaskRunner(pool->GetSequenceToken());
+}
+
+DevToolsFileSystemIndexer::~DevToolsFileSystemIndexer() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+}
+
+scoped_refptr<DevToolsFileSystemIndexer::IndexingJob>
+DevToolsFileSystemIndexer::IndexPath(
+    const base::FilePath& path,
+    const TotalWorkCallback& total_work_callback,
+    const WorkedCallback& worked_callback,
+    const DoneCallback& done_callback) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+
+  scoped_refptr<IndexingJob> job(new IndexingJob(
+      path, total_work_callback, worked_callback, done_callback));
+  index_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::AddRoot, this, path));
+  index_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::ScanPath, this, job));
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::WatchPath, this, path));
+  return job;
+}
+
+void DevToolsFileSystemIndexer::SearchInPath(const base::FilePath& path,
+                                             const std::string& query,
+                                             const SearchCallback& callback) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  index_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::SearchInPathOnIndexSequence,
+                 this, path, query, callback));
+}
+
+void DevToolsFileSystemIndexer::RemovePath(const base::FilePath& path) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::UnwatchPath, this, path));
+  index_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::RemovePathOnIndexSequence,
+                 this, path));
+}
+
+void DevToolsFileSystemIndexer::AddRoot(const base::FilePath& path) {
+  roots_.insert(path);
+}
+
+void DevToolsFileSystemIndexer::ScanPath(scoped_refptr<IndexingJob> job) {
+  const base::FilePath& target = job->path_;
+  pending_rescans_.erase(target);
+
+  // A change can be reported after its root has been removed.
+  bool in_root = false;
+  for (auto it = roots_.begin(); it != roots_.end() && !in_root; ++it)
+    in_root = IsInside(*it, target);
+  if (!in_root) {
+    job->ReportDone();
+    return;
+  }
+
+  // Whatever isn't seen again has been deleted.
+  std::set<base::FilePath::StringType> unseen;
+  for (auto it = file_ids_.begin(); it != file_ids_.end(); ++it) {
+    if (IsInside(target, base::FilePath(it->first)))
+      unseen.insert(it->first);
+  }
+
+  std::vector<FileEntry> changed;
+  base::PlatformFileInfo info;
+  if (!job->stopped_.IsSet() && file_util::GetFileInfo(target, &info)) {
+    if (!info.is_directory) {
+      ConsiderFile(target, info.last_modified, info.size, &unseen, &changed);
+    } else {
+      // Walk the tree by hand so hidden folders aren't descended into.
+      std::vector<base::FilePath> folders(1, target);
+      while (!folders.empty() && !job->stopped_.IsSet()) {
+        base::FileEnumerator enumerator(
+            folders.back(), false,
+            base::FileEnumerator::FILES | base::FileEnumerator::DIRECTORIES);
+        folders.pop_back();
+        for (auto path = enumerator.Next(); !path.empty();
+             path = enumerator.Next()) {
+          if (IsHidden(path))
+            continue;
+          auto file_info = enumerator.GetInfo();
+          if (file_info.IsDirectory())
+            folders.push_back(path);
+          else
+            ConsiderFile(path, file_info.GetLastModifiedTime(),
+                         file_info.GetSize(), &unseen, &changed);
+        }
+      }
+    }
+  }
+
+  // A stopped job hasn't seen everything, so it mustn't remove anything.
+  if (!job->stopped_.IsSet()) {
+    for (auto it = unseen.begin(); it != unseen.end(); ++it)
+      RemoveFile(*it);
+    MaybeCompact();
+  }
+
+  job->ReportTotalWork(static_cast<int>(changed.size()));
+  if (changed.empty()) {
+    job->ReportDone();
+    return;
+  }
+
+  job->pending_batches_ =
+      static_cast<int>((changed.size() + kFilesPerBatch - 1) / kFilesPerBatch);
+  for (size_t i = 0; i < changed.size(); i += kFilesPerBatch) {
+    size_t end = std::min(i + kFilesPerBatch, changed.size());
+    BrowserThread::PostBlockingPoolTask(
+        FROM_HERE,
+        base::Bind(&DevToolsFileSystemIndexer::ReadBatch, this, job,
+                   std::vector<FileEntry>(changed.begin() + i,
+                                          changed.begin() + end)));
+  }
+}
+
+void DevToolsFileSystemIndexer::ConsiderFile(
+    const base::FilePath& path,
+    const base::Time& last_modified,
+    int64 size,
+    std::set<base::FilePath::StringType>* unseen,
+    std::vector<FileEntry>* changed) {
+  unseen->erase(path.value());
+  auto it = file_ids_.find(path.value());
+  if (it != file_ids_.end() &&
+      files_[it->second].last_modified == last_modified &&
+      files_[it->second].size == size)
+    return;
+
+  FileEntry entry;
+  entry.path = path;
+  entry.last_modified = last_modified;
+  entry.size = size;
+  entry.live = true;
+  changed->push_back(entry);
+}
+
+void DevToolsFileSystemIndexer::ReadBatch(
+    scoped_refptr<IndexingJob> job,
+    const std::vector<FileEntry>& entries) {
+  auto batch = new std::vector<IndexedFile>;
+  // Files of a stopped job are left out of the index, so they're read the
+  // next time it's brought up to date.
+  if (!job->stopped_.IsSet()) {
+    batch->resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+      IndexedFile& file = (*batch)[i];
+      file.entry = entries[i];
+      if (entries[i].size > kMaxFileSize)
+        continue;
+      std::string contents;
+      if (!file_util::ReadFileToString(entries[i].path, &contents) ||
+          IsBinary(contents))
+        continue;
+      ExtractTrigrams(contents, &file.trigrams);
+    }
+  }
+
+  index_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::MergeBatch, this, job,
+                 base::Owned(batch)));
+}
+
+void DevToolsFileSystemIndexer::MergeBatch(
+    scoped_refptr<IndexingJob> job,
+    const std::vector<IndexedFile>* batch) {
+  for (auto it = batch->begin(); it != batch->end(); ++it) {
+    const auto& path = it->entry.path.value();
+    RemoveFile(path);
+
+    // Ids only grow, so appending keeps the posting lists sorted.
+    int id = static_cast<int>(files_.size());
+    files_.push_back(it->entry);
+    file_ids_[path] = id;
+    for (auto trigram = it->trigrams.begin(); trigram != it->trigrams.end();
+         ++trigram)
+      postings_[*trigram].push_back(id);
+  }
+  MaybeCompact();
+
+  job->ReportWorked(static_cast<int>(batch->size()));
+  if (--job->pending_batches_ == 0)
+    job->ReportDone();
+}
+
+void DevToolsFileSystemIndexer::QueueRescan(const base::FilePath& path) {
+  if (!pending_rescans_.insert(path).second)
+    return;
+  scoped_refptr<IndexingJob> job(new IndexingJob(
+      path, TotalWorkCallback(), WorkedCallback(), DoneCallback()));
+  index_runner_->PostDelayedTask(
+      FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::ScanPath, this, job),
+      base::TimeDelta::FromMilliseconds(kRescanDelayMs));
+}
+
+void DevToolsFileSystemIndexer::SearchInPathOnIndexSequence(
+    const base::FilePath& path,
+    const std::string& query,
+    const SearchCallback& callback) {
+  std::vector<uint32> trigrams;
+  ExtractTrigrams(query, &trigrams);
+
+  std::vector<int> candidates;
+  if (trigrams.empty()) {
+    // Too short to narrow anything down.
+    for (size_t id = 0; id < files_.size(); ++id)
+      candidates.push_back(static_cast<int>(id));
+  } else {
+    for (auto it = trigrams.begin(); it != trigrams.end(); ++it) {
+      auto posting = postings_.find(*it);
+      if (posting == postings_.end()) {
+        candidates.clear();
+        break;
+      }
+      if (it == trigrams.begin()) {
+        candidates = posting->second;
+        continue;
+      }
+      std::vector<int> intersection;
+      std::set_intersection(candidates.begin(), candidates.end(),
+                            posting->second.begin(), posting->second.end(),
+                            std::back_inserter(intersection));
+      candidates.swap(intersection);
+      if (candidates.empty())
+        break;
+    }
+  }
+
+  std::vector<std::string> results;
+  for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+    const FileEntry& entry = files_[*it];
+    if (entry.live && IsInside(path, entry.path))
+      results.push_back(entry.path.AsUTF8Unsafe());
+  }
+
+  BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
+                          base::Bind(callback, results));
+}
+
+void DevToolsFileSystemIndexer::RemovePathOnIndexSequence(
+    const base::FilePath& path) {
+  roots_.erase(path);
+  std::vector<base::FilePath::StringType> removed;
+  for (auto it = file_ids_.begin(); it != file_ids_.end(); ++it) {
+    if (IsInside(path, base::FilePath(it->first)))
+      removed.push_back(it->first);
+  }
+  for (auto it = removed.begin(); it != removed.end(); ++it)
+    RemoveFile(*it);
+  MaybeCompact();
+}
+
+void DevToolsFileSystemIndexer::RemoveFile(
+    const base::FilePath::StringType& path) {
+  auto it = file_ids_.find(path);
+  if (it == file_ids_.end())
+    return;
+  files_[it->second].live = false;
+  file_ids_.erase(it);
+  ++removed_files_;
+}
+
+void DevToolsFileSystemIndexer::MaybeCompact() {
+  if (removed_files_ < 1024 || removed_files_ < file_ids_.size())
+    return;
+
+  // Renumbering in order keeps the posting lists sorted.
+  std::vector<int> new_ids(files_.size(), -1);
+  std::vector<FileEntry> files;
+  files.reserve(file_ids_.size());
+  for (size_t id = 0; id < files_.size(); ++id) {
+    if (!files_[id].live)
+      continue;
+    new_ids[id] = static_cast<int>(files.size());
+    file_ids_[files_[id].path.value()] = new_ids[id];
+    files.push_back(files_[id]);
+  }
+  files_.swap(files);
+
+  for (auto it = postings_.begin(); it != postings_.end();) {
+    std::vector<int> ids;
+    for (auto id = it->second.begin(); id != it->second.end(); ++id) {
+      if (new_ids[*id] != -1)
+        ids.push_back(new_ids[*id]);
+    }
+    if (ids.empty()) {
+      postings_.erase(it++);
+    } else {
+      it->second.swap(ids);
+      ++it;
+    }
+  }
+  removed_files_ = 0;
+}
+
+void DevToolsFileSystemIndexer::WatchPath(const base::FilePath& path) {
+  if (watchers_.count(path))
+    return;
+
+  // Unretained is safe because the watcher is destroyed with us, on this
+  // thread.
+  linked_ptr<base::FilePathWatcher> watcher(new base::FilePathWatcher);
+  if (!watcher->Watch(path, true,
+                      base::Bind(&DevToolsFileSystemIndexer::OnPathChanged,
+                                 base::Unretained(this), path))) {
+    // Changes are then only picked up by the next IndexPath().
+    LOG(WARNING) << "Can't watch " << path.value() << " for changes";
+    return;
+  }
+  watchers_[path] = watcher;
+}
+
+void DevToolsFileSystemIndexer::UnwatchPath(const base::FilePath& path) {
+  watchers_.erase(path);
+}
+
+void DevToolsFileSystemIndexer::OnPathChanged(const base::FilePath& root,
+                                              const base::FilePath& path,
+                                              bool error) {
+  // Some platforms only report that something under |root| changed.
+  base::FilePath changed = error || !IsInside(root, path) ? root : path;
+
+  base::FilePath relative;
+  if (root.AppendRelativePath(changed, &relative)) {
+    std::vector<base::FilePath::StringType> components;
+    relative.GetComponents(&components);
+    for (auto it = components.begin(); it != components.end(); ++it) {
+      if (!it->empty() && (*it)[0] == '.')
+        return;
+    }
+  }
+
+  index_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DevToolsFileSystemIndexer::QueueRescan, this, changed));
+}
+
+}  // namespace brightray
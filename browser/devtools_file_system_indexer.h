@@ -0,0 +1,176 @@
+#ifndef BRIGHTRAY_BROWSER_DEVTOOLS_FILE_SYSTEM_INDEXER_H_
+#define BRIGHTRAY_BROWSER_DEVTOOLS_FILE_SYSTEM_INDEXER_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/containers/hash_tables.h"
+#include "base/files/file_path.h"
+#include "base/memory/linked_ptr.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/cancellation_flag.h"
+#include "base/time/time.h"
+#include "content/public/browser/browser_thread.h"
+
+namespace base {
+class FilePathWatcher;
+class SequencedTaskRunner;
+}
+
+namespace brightray {
+
+// Keeps a trigram index of the files under the folders added to DevTools as
+// file systems, so the frontend's workspace search only has to read the
+// files that can contain the query.
+//
+// Files are listed and the index is updated on a sequence of the blocking
+// pool, while their contents are read and split into trigrams on other
+// blocking pool threads, a batch of files at a time. Once a folder has been
+// indexed it is watched for changes, and only files whose modification time
+// changed are read again.
+//
+// Public methods must be called on the UI thread, and callbacks are run
+// there.
+class DevToolsFileSystemIndexer
+    : public base::RefCountedThreadSafe<
+          DevToolsFileSystemIndexer,
+          content::BrowserThread::DeleteOnFileThread> {
+ public:
+  typedef base::Callback<void(int total_work)> TotalWorkCallback;
+  typedef base::Callback<void(int worked)> WorkedCallback;
+  typedef base::Callback<void()> DoneCallback;
+  typedef base::Callback<void(const std::vector<std::string>& file_paths)>
+      SearchCallback;
+
+  class IndexingJob : public base::RefCountedThreadSafe<IndexingJob> {
+   public:
+    // No callbacks are run after this. Files that were already read stay in
+    // the index.
+    void Stop();
+
+   private:
+    friend class base::RefCountedThreadSafe<IndexingJob>;
+    friend class DevToolsFileSystemIndexer;
+
+    IndexingJob(const base::FilePath& path,
+                const TotalWorkCallback& total_work_callback,
+                const WorkedCallback& worked_callback,
+                const DoneCallback& done_callback);
+    ~IndexingJob();
+
+    // These can be called on any thread; the callbacks are run on the UI
+    // thread unless the job has been stopped by then.
+    void ReportTotalWork(int total_work);
+    void ReportWorked(int worked);
+    void ReportDone();
+    void RunUnlessStopped(const base::Closure& closure);
+
+    base::FilePath path_;
+    TotalWorkCallback total_work_callback_;
+    WorkedCallback worked_callback_;
+    DoneCallback done_callback_;
+    base::CancellationFlag stopped_;
+    // Only used on the index sequence.
+    int pending_batches_;
+
+    DISALLOW_COPY_AND_ASSIGN(IndexingJob);
+  };
+
+  DevToolsFileSystemIndexer();
+
+  // Brings the index of the files under |path| up to date and starts
+  // watching it. |total_work_callback| is told how many files need to be
+  // read, and |worked_callback| how many more have been as reading goes on.
+  scoped_refptr<IndexingJob> IndexPath(
+      const base::FilePath& path,
+      const TotalWorkCallback& total_work_callback,
+      const WorkedCallback& worked_callback,
+      const DoneCallback& done_callback);
+
+  // Runs |callback| with the indexed files under |path| that may contain
+  // |query|. Matching ignores ASCII case.
+  void SearchInPath(const base::FilePath& path,
+                    const std::string& query,
+                    const SearchCallback& callback);
+
+  // Stops watching |path| and drops its files from the index.
+  void RemovePath(const base::FilePath& path);
+
+ private:
+  friend struct content::BrowserThread::DeleteOnThread<
+      content::BrowserThread::FILE>;
+  friend class base::DeleteHelper<DevToolsFileSystemIndexer>;
+
+  struct FileEntry {
+    base::FilePath path;
+    base::Time last_modified;
+    int64 size;
+    bool live;
+  };
+
+  // A file read by a batch, and its trigrams.
+  struct IndexedFile {
+    FileEntry entry;
+    std::vector<uint32> trigrams;
+  };
+
+  // The watchers are destroyed with us on the FILE thread.
+  ~DevToolsFileSystemIndexer();
+
+  // Run on the index sequence. |job|'s path can be a root, or a file or
+  // folder under one that changed.
+  void AddRoot(const base::FilePath& path);
+  void ScanPath(scoped_refptr<IndexingJob> job);
+  // Adds |path| to |changed| unless it's indexed and unchanged.
+  void ConsiderFile(const base::FilePath& path,
+                    const base::Time& last_modified,
+                    int64 size,
+                    std::set<base::FilePath::StringType>* unseen,
+                    std::vector<FileEntry>* changed);
+  void MergeBatch(scoped_refptr<IndexingJob> job,
+                  const std::vector<IndexedFile>* batch);
+  void QueueRescan(const base::FilePath& path);
+  void SearchInPathOnIndexSequence(const base::FilePath& path,
+                                   const std::string& query,
+                                   const SearchCallback& callback);
+  void RemovePathOnIndexSequence(const base::FilePath& path);
+  void RemoveFile(const base::FilePath::StringType& path);
+  // Drops the entries of removed files once they outnumber the live ones.
+  void MaybeCompact();
+
+  // Run on other blocking pool threads.
+  void ReadBatch(scoped_refptr<IndexingJob> job,
+                 const std::vector<FileEntry>& entries);
+
+  // Run on the FILE thread.
+  void WatchPath(const base::FilePath& path);
+  void UnwatchPath(const base::FilePath& path);
+  void OnPathChanged(const base::FilePath& root,
+                     const base::FilePath& path,
+                     bool error);
+
+  scoped_refptr<base::SequencedTaskRunner> index_runner_;
+
+  // Only used on the index sequence. Ids are indices in |files_|; a file
+  // that changes gets a new id and its old entry stops being live, so that
+  // every posting list stays sorted.
+  std::vector<FileEntry> files_;
+  base::hash_map<base::FilePath::StringType, int> file_ids_;
+  base::hash_map<uint32, std::vector<int> > postings_;
+  size_t removed_files_;
+  std::set<base::FilePath> roots_;
+  // Paths that have a rescan queued because they changed.
+  std::set<base::FilePath> pending_rescans_;
+
+  // Only used on the FILE thread.
+  std::map<base::FilePath, linked_ptr<base::FilePathWatcher> > watchers_;
+
+  DISALLOW_COPY_AND_ASSIGN(DevToolsFileSystemIndexer);
+};
+
+}  // namespace brightray
+
+#endif
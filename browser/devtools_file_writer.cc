@@ -0,0 +1,307 @@
+#include "browser/devtools_file_writer.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/platform_file.h"
+#include "third_party/zlib/zlib.h"
+
+using content::BrowserThread;
+
+namespace brightray {
+
+namespace {
+
+// Buffered data is written once there's this much of it, even if more
+// appends are waiting.
+const size_t kMaxBufferSize = 1024 * 1024;
+
+// Size of the chunks compressed output is written in.
+const size_t kDeflateChunkSize = 64 * 1024;
+
+// zlib adds a gzip header and trailer with this many window bits.
+const int kGzipWindowBits = 15 + 16;
+const int kGzipMemLevel = 8;
+
+const base::FilePath::CharType kGzipExtension[] = FILE_PATH_LITERAL(".gz");
+
+// How long a file stays open after its last write, in case more is appended.
+const int kIdleCloseDelaySeconds = 10;
+
+void RunOnUIThread(const base::Closure& callback) {
+  BrowserThread::PostTask(BrowserThread::UI, FROM_HERE, callback);
+}
+
+}  // namespace
+
+// A saved file and the data waiting to be written to it. The file is closed
+// while it's idle and opened again by the next append. Only used on the
+// FILE thread.
+class DevToolsFileWriter::File {
+ public:
+  File(const base::FilePath& path, bool gzip)
+      : path_(path),
+        file_(base::kInvalidPlatformFileValue),
+        gzip_(gzip),
+        deflating_(false),
+        failed_(false),
+        flush_scheduled_(false),
+        appends_(0) {
+    Open(base::PLATFORM_FILE_CREATE_ALWAYS | base::PLATFORM_FILE_WRITE);
+  }
+
+  ~File() {
+    Close();
+  }
+
+  // Takes over |data| and queues |callback| to run once it's written, or
+  // has failed to be.
+  void Append(std::string* data, const WriteCallback& callback) {
+    ++appends_;
+    if (file_ == base::kInvalidPlatformFileValue && !failed_)
+      Open(base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_WRITE);
+
+    if (buffer_.size() + data->size() > kMaxBufferSize)
+      Flush();
+    // Nothing needs to be copied when the buffer is empty, which it always
+    // is for chunks larger than the buffer.
+    if (buffer_.empty())
+      buffer_.swap(*data);
+    else
+      buffer_.append(*data);
+    callbacks_.push_back(callback);
+    if (buffer_.size() >= kMaxBufferSize)
+      Flush();
+  }
+
+  // Writes out the buffer and runs the callbacks of the data in it.
+  void Flush() {
+    flush_scheduled_ = false;
+    if (buffer_.empty() && callbacks_.empty())
+      return;
+
+    bool written = gzip_ ?
+        Deflate(buffer_.data(), buffer_.size(), Z_SYNC_FLUSH) :
+        Write(buffer_.data(), buffer_.size());
+    std::string().swap(buffer_);
+    std::vector<WriteCallback> callbacks;
+    callbacks.swap(callbacks_);
+
+    if (!written && !failed_) {
+      LOG(ERROR) << "Can't write to " << path_.value();
+      Fail();
+    }
+    for (auto it = callbacks.begin(); it != callbacks.end(); ++it)
+      RunOnUIThread(base::Bind(*it, written));
+  }
+
+  // Returns true if the caller should post a task to Flush(). Appends that
+  // are already queued on the FILE thread run before it, so a burst of them
+  // ends up in one write.
+  bool ScheduleFlush() {
+    if (flush_scheduled_ || callbacks_.empty())
+      return false;
+    flush_scheduled_ = true;
+    return true;
+  }
+
+  // Counts the appends so far, to tell whether any came in after a flush.
+  int appends() const { return appends_; }
+
+  // Writes out the buffer and closes the file; a gzip file is complete
+  // after this. The next append opens it again.
+  void Close() {
+    Flush();
+    if (deflating_) {
+      Deflate(NULL, 0, Z_FINISH);
+      deflateEnd(&stream_);
+      deflating_ = false;
+    }
+    CloseFile();
+  }
+
+ private:
+  void Open(int flags) {
+    file_ = base::CreatePlatformFile(path_, flags, NULL, NULL);
+    if (file_ == base::kInvalidPlatformFileValue) {
+      LOG(ERROR) << "Can't open " << path_.value() << " for writing";
+      failed_ = true;
+      return;
+    }
+    if ((flags & base::PLATFORM_FILE_OPEN) &&
+        base::SeekPlatformFile(file_, base::PLATFORM_FILE_FROM_END, 0) < 0) {
+      LOG(ERROR) << "Can't append to " << path_.value();
+      Fail();
+      return;
+    }
+
+    // A reopened gzip file gets another gzip member, which decompressors
+    // concatenate with the earlier ones.
+    if (gzip_) {
+      memset(&stream_, 0, sizeof(stream_));
+      if (deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                       kGzipWindowBits, kGzipMemLevel,
+                       Z_DEFAULT_STRATEGY) != Z_OK) {
+        LOG(ERROR) << "Can't compress " << path_.value();
+        Fail();
+        return;
+      }
+      deflating_ = true;
+    }
+  }
+
+  // Gives up on the file. Later data is dropped, and its callbacks are told
+  // it wasn't written.
+  void Fail() {
+    failed_ = true;
+    if (deflating_) {
+      deflateEnd(&stream_);
+      deflating_ = false;
+    }
+    CloseFile();
+  }
+
+  void CloseFile() {
+    if (file_ == base::kInvalidPlatformFileValue)
+      return;
+    base::ClosePlatformFile(file_);
+    file_ = base::kInvalidPlatformFileValue;
+  }
+
+  bool Write(const char* data, size_t size) {
+    if (file_ == base::kInvalidPlatformFileValue)
+      return false;
+    while (size) {
+      int written = base::WritePlatformFileAtCurrentPos(
+          file_, data, static_cast<int>(size));
+      if (written <= 0)
+        return false;
+      data += written;
+      size -= written;
+    }
+    return true;
+  }
+
+  bool Deflate(const char* data, size_t size, int flush) {
+    if (file_ == base::kInvalidPlatformFileValue)
+      return false;
+    stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream_.avail_in = static_cast<uInt>(size);
+
+    char output[kDeflateChunkSize];
+    do {
+      stream_.next_out = reinterpret_cast<Bytef*>(output);
+      stream_.avail_out = sizeof(output);
+      int result = deflate(&stream_, flush);
+      if (result == Z_STREAM_ERROR)
+        return false;
+      if (!Write(output, sizeof(output) - stream_.avail_out))
+        return false;
+    } while (stream_.avail_out == 0);
+    return true;
+  }
+
+  base::FilePath path_;
+  base::PlatformFile file_;
+  bool gzip_;
+  // Whether |stream_| has been set up and needs to be ended.
+  bool deflating_;
+  z_stream stream_;
+  // Set once the file can't be opened or written to.
+  bool failed_;
+  std::string buffer_;
+  std::vector<WriteCallback> callbacks_;
+  bool flush_scheduled_;
+  int appends_;
+
+  DISALLOW_COPY_AND_ASSIGN(File);
+};
+
+DevToolsFileWriter::DevToolsFileWriter() {
+}
+
+DevToolsFileWriter::~DevToolsFileWriter() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+}
+
+void DevToolsFileWriter::Save(const std::string& url,
+                              const base::FilePath& path,
+                              std::string* content,
+                              const WriteCallback& callback) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  saved_urls_.insert(url);
+
+  auto owned_content = new std::string;
+  owned_content->swap(*content);
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&DevToolsFileWriter::SaveOnFileThread, this, url, path,
+                 base::Owned(owned_content), callback));
+}
+
+bool DevToolsFileWriter::Append(const std::string& url,
+                                std::string* content,
+                                const WriteCallback& callback) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  if (!saved_urls_.count(url))
+    return false;
+
+  auto owned_content = new std::string;
+  owned_content->swap(*content);
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&DevToolsFileWriter::AppendOnFileThread, this, url,
+                 base::Owned(owned_content), callback));
+  return true;
+}
+
+void DevToolsFileWriter::SaveOnFileThread(const std::string& url,
+                                          const base::FilePath& path,
+                                          std::string* content,
+                                          const WriteCallback& callback) {
+  // Finish the old file before the new one is opened, in case they're the
+  // same.
+  files_.erase(url);
+  bool gzip = path.MatchesExtension(kGzipExtension);
+  files_[url] = linked_ptr<File>(new File(path, gzip));
+  AppendOnFileThread(url, content, callback);
+}
+
+void DevToolsFileWriter::AppendOnFileThread(const std::string& url,
+                                            std::string* content,
+                                            const WriteCallback& callback) {
+  auto it = files_.find(url);
+  if (it == files_.end()) {
+    RunOnUIThread(base::Bind(callback, false));
+    return;
+  }
+  it->second->Append(content, callback);
+  if (it->second->ScheduleFlush()) {
+    BrowserThread::PostTask(
+        BrowserThread::FILE, FROM_HERE,
+        base::Bind(&DevToolsFileWriter::FlushOnFileThread, this, url));
+  }
+}
+
+void DevToolsFileWriter::FlushOnFileThread(const std::string& url) {
+  auto it = files_.find(url);
+  if (it == files_.end())
+    return;
+  it->second->Flush();
+
+  BrowserThread::PostDelayedTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&DevToolsFileWriter::CloseIfIdleOnFileThread, this, url,
+                 it->second->appends()),
+      base::TimeDelta::FromSeconds(kIdleCloseDelaySeconds));
+}
+
+void DevToolsFileWriter::CloseIfIdleOnFileThread(const std::string& url,
+                                                 int appends) {
+  auto it = files_.find(url);
+  if (it != files_.end() && it->second->appends() == appends)
+    it->second->Close();
+}
+
+}  // namespace brightray
@@ -0,0 +1,87 @@
+#ifndef BRIGHTRAY_BROWSER_DEVTOOLS_FILE_WRITER_H_
+#define BRIGHTRAY_BROWSER_DEVTOOLS_FILE_WRITER_H_
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "base/callback.h"
+#include "base/memory/linked_ptr.h"
+#include "base/memory/ref_counted.h"
+#include "content/public/browser/browser_thread.h"
+
+namespace base {
+class FilePath;
+}
+
+namespace brightray {
+
+// Writes the files DevTools saves (heap snapshots, timelines, edited
+// sources) on the FILE thread. A saved URL's file stays open while appends
+// to it keep streaming in, and is closed once nothing has been appended for
+// a few seconds; a later append opens it again. Appends that arrive while
+// the FILE thread is busy are coalesced into one write. A file whose path
+// ends in ".gz" is gzip-compressed as it's written, and is complete each
+// time it's closed.
+//
+// Public methods must be called on the UI thread, and callbacks are run
+// there.
+class DevToolsFileWriter
+    : public base::RefCountedThreadSafe<
+          DevToolsFileWriter,
+          content::BrowserThread::DeleteOnFileThread> {
+ public:
+  // Told whether the data was written.
+  typedef base::Callback<void(bool success)> WriteCallback;
+
+  DevToolsFileWriter();
+
+  // Starts |url|'s file over at |path| with |content|, which is taken over
+  // rather than copied. |callback| is run once it's on disk, or once it's
+  // failed to get there.
+  void Save(const std::string& url,
+            const base::FilePath& path,
+            std::string* content,
+            const WriteCallback& callback);
+
+  // Adds |content| to the end of |url|'s file, taking it over like Save().
+  // Returns false if |url| hasn't been saved.
+  bool Append(const std::string& url,
+              std::string* content,
+              const WriteCallback& callback);
+
+ private:
+  friend struct content::BrowserThread::DeleteOnThread<
+      content::BrowserThread::FILE>;
+  friend class base::DeleteHelper<DevToolsFileWriter>;
+
+  class File;
+
+  // Closes every file.
+  ~DevToolsFileWriter();
+
+  // Run on the FILE thread. They take ownership of |content|.
+  void SaveOnFileThread(const std::string& url,
+                        const base::FilePath& path,
+                        std::string* content,
+                        const WriteCallback& callback);
+  void AppendOnFileThread(const std::string& url,
+                          std::string* content,
+                          const WriteCallback& callback);
+  void FlushOnFileThread(const std::string& url);
+  // Closes |url|'s file unless it's been appended to since it had
+  // |appends|.
+  void CloseIfIdleOnFileThread(const std::string& url, int appends);
+
+  // Only used on the UI thread.
+  std::set<std::string> saved_urls_;
+
+  // Only used on the FILE thread.
+  std::map<std::string, linked_ptr<File> > files_;
+
+  DISALLOW_COPY_AND_ASSIGN(DevToolsFileWriter);
+};
+
+}  // namespace brightray
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "browser/devtools_ui.h"
 
+#include <map>
 #include <string>
 
 #include "browser/browser_context.h"
@@ -25,27 +26,31 @@ namespace {
 
 const char kChromeUIDevToolsBundledHost[] = "devtools";
 
+struct MimeTypeForExtension {
+  const char* extension;
+  const char* mime_type;
+};
+
+const MimeTypeForExtension kMimeTypes[] = {
+  { ".css", "text/css" },
+  { ".gif", "image/gif" },
+  { ".html", "text/html" },
+  { ".js", "application/javascript" },
+  { ".manifest", "text/cache-manifest" },
+  { ".png", "image/png" },
+  { ".svg", "image/svg+xml" },
+};
+
 std::string PathWithoutParams(const std::string& path) {
-  return GURL(std::string("chrome-devtools://devtools/") + path)
-      .path().substr(1);
+  return path.substr(0, path.find_first_of("?#"));
 }
 
 std::string GetMimeTypeForPath(const std::string& path) {
   std::string filename = PathWithoutParams(path);
-  if (EndsWith(filename, ".html", false)) {
-    return "text/html";
-  } else if (EndsWith(filename, ".css", false)) {
-    return "text/css";
-  } else if (EndsWith(filename, ".js", false)) {
-    return "application/javascript";
-  } else if (EndsWith(filename, ".png", false)) {
-    return "image/png";
-  } else if (EndsWith(filename, ".gif", false)) {
-    return "image/gif";
-  } else if (EndsWith(filename, ".manifest", false)) {
-    return "text/cache-manifest";
+  for (size_t i = 0; i < arraysize(kMimeTypes); ++i) {
+    if (EndsWith(filename, kMimeTypes[i].extension, false))
+      return kMimeTypes[i].mime_type;
   }
-  NOTREACHED();
   return "text/plain";
 }
 
@@ -65,18 +70,39 @@ class BundledDataSource : public content::URLDataSource {
                                 const GotDataCallback& callback) OVERRIDE {
     std::string filename = PathWithoutParams(path);
 
+    auto it = resources_.find(filename);
+    if (it != resources_.end()) {
+      callback.Run(it->second);
+      return;
+    }
+
     int resource_id =
         content::DevToolsHttpHandler::GetFrontendResourceId(filename);
+    if (resource_id == -1) {
+      // Not remembered, so that requests for made-up paths can't grow the
+      // map without bound.
+      DLOG(WARNING) << "Unable to find dev tool resource: " << filename
+                    << ". If you compiled with debug_devtools=1, try running "
+                    << "with --debug-devtools.";
+      callback.Run(NULL);
+      return;
+    }
 
-    DLOG_IF(WARNING, -1 == resource_id) << "Unable to find dev tool resource: "
-        << filename << ". If you compiled with debug_devtools=1, try running"
-        " with --debug-devtools.";
     const ResourceBundle& rb = ResourceBundle::GetSharedInstance();
-    scoped_refptr<base::RefCountedStaticMemory> bytes(rb.LoadDataResourceBytes(
-        resource_id));
+    scoped_refptr<base::RefCountedStaticMemory> bytes(
+        rb.LoadDataResourceBytes(resource_id));
+    if (bytes)
+      resources_[filename] = bytes;
     callback.Run(bytes);
   }
 
+  // Resources come straight out of the ResourceBundle, so there's no need
+  // to hop to the UI thread for them.
+  virtual base::MessageLoop* MessageLoopForRequestPath(
+      const std::string& path) const OVERRIDE {
+    return NULL;
+  }
+
   virtual std::string GetMimeType(const std::string& path) const OVERRIDE {
     return GetMimeTypeForPath(path);
   }
@@ -87,6 +113,12 @@ class BundledDataSource : public content::URLDataSource {
 
  private:
   virtual ~BundledDataSource() {}
+
+  // Maps frontend file names to their bytes, which stay valid for the life
+  // of the ResourceBundle. Only touched on the IO thread.
+  std::map<std::string, scoped_refptr<base::RefCountedStaticMemory> >
+      resources_;
+
   DISALLOW_COPY_AND_ASSIGN(BundledDataSource);
 };
 
@@ -0,0 +1,259 @@
+#include "browser/file_pref_store.h"
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/json/json_file_value_serializer.h"
+#include "base/json/json_string_value_serializer.h"
+#include "base/sequenced_task_runner.h"
+#include "base/values.h"
+
+namespace brightray {
+
+namespace {
+
+// Keeps a corrupt file as "Preferences.bad", so it can be looked at later
+// and isn't lost when the store writes its defaults over it. Returns
+// PREF_READ_ERROR_JSON_REPEAT if an earlier corrupt file was already kept.
+PersistentPrefStore::PrefReadError MoveBadFileAside(
+    const base::FilePath& path,
+    PersistentPrefStore::PrefReadError error) {
+  base::FilePath bad_path = path.ReplaceExtension(FILE_PATH_LITERAL("bad"));
+  bool bad_path_existed = base::PathExists(bad_path);
+  if (!base::Move(path, bad_path)) {
+    LOG(ERROR) << "Can't move " << path.value() << " aside";
+    return PersistentPrefStore::PREF_READ_ERROR_FILE_OTHER;
+  }
+  return bad_path_existed ? PersistentPrefStore::PREF_READ_ERROR_JSON_REPEAT :
+                            error;
+}
+
+PersistentPrefStore::PrefReadError ReadPrefsFile(
+    const base::FilePath& path,
+    scoped_ptr<base::Value>* value) {
+  JSONFileValueSerializer serializer(path);
+  int error_code = 0;
+  std::string error_message;
+  value->reset(serializer.Deserialize(&error_code, &error_message));
+  if (!*value) {
+    switch (error_code) {
+      case JSONFileValueSerializer::JSON_ACCESS_DENIED:
+        return PersistentPrefStore::PREF_READ_ERROR_ACCESS_DENIED;
+      case JSONFileValueSerializer::JSON_CANNOT_READ_FILE:
+        return PersistentPrefStore::PREF_READ_ERROR_FILE_OTHER;
+      case JSONFileValueSerializer::JSON_FILE_LOCKED:
+        return PersistentPrefStore::PREF_READ_ERROR_FILE_LOCKED;
+      case JSONFileValueSerializer::JSON_NO_SUCH_FILE:
+        return PersistentPrefStore::PREF_READ_ERROR_NO_FILE;
+      default:
+        return MoveBadFileAside(
+            path, PersistentPrefStore::PREF_READ_ERROR_JSON_PARSE);
+    }
+  }
+  if (!(*value)->IsType(base::Value::TYPE_DICTIONARY)) {
+    value->reset();
+    return MoveBadFileAside(path,
+                            PersistentPrefStore::PREF_READ_ERROR_JSON_TYPE);
+  }
+  return PersistentPrefStore::PREF_READ_ERROR_NONE;
+}
+
+}  // namespace
+
+struct FilePrefStore::ReadResult {
+  ReadResult() : error(PREF_READ_ERROR_NONE) {}
+
+  scoped_ptr<base::Value> value;
+  PrefReadError error;
+};
+
+// static
+void FilePrefStore::ReadOnTaskRunner(const base::FilePath& path,
+                                     ReadResult* result) {
+  result->error = ReadPrefsFile(path, &result->value);
+}
+
+FilePrefStore::FilePrefStore(const base::FilePath& path,
+                             base::SequencedTaskRunner* task_runner,
+                             base::TimeDelta commit_interval)
+    : path_(path),
+      task_runner_(task_runner),
+      prefs_(new base::DictionaryValue),
+      read_only_(false),
+      initialized_(false),
+      dirty_before_read_(false),
+      read_error_(PREF_READ_ERROR_NONE),
+      writer_(path, task_runner) {
+  writer_.set_commit_interval(commit_interval);
+}
+
+FilePrefStore::~FilePrefStore() {
+  CommitPendingWrite();
+}
+
+PrefWriteStats FilePrefStore::write_stats() const {
+  PrefWriteStats stats = write_stats_;
+  auto hour_ago = base::TimeTicks::Now() - base::TimeDelta::FromHours(1);
+  for (auto it = recent_writes_.begin(); it != recent_writes_.end(); ++it) {
+    if (it->first >= hour_ago)
+      stats.bytes_written_last_hour += it->second;
+  }
+  return stats;
+}
+
+bool FilePrefStore::GetValue(const std::string& key,
+                             const base::Value** result) const {
+  const base::Value* value = NULL;
+  if (!prefs_->Get(key, &value))
+    return false;
+  if (result)
+    *result = value;
+  return true;
+}
+
+void FilePrefStore::AddObserver(PrefStore::Observer* observer) {
+  observers_.AddObserver(observer);
+}
+
+void FilePrefStore::RemoveObserver(PrefStore::Observer* observer) {
+  observers_.RemoveObserver(observer);
+}
+
+bool FilePrefStore::HasObservers() const {
+  return observers_.might_have_observers();
+}
+
+bool FilePrefStore::IsInitializationComplete() const {
+  return initialized_;
+}
+
+bool FilePrefStore::GetMutableValue(const std::string& key,
+                                    base::Value** result) {
+  return prefs_->Get(key, result);
+}
+
+void FilePrefStore::ReportValueChanged(const std::string& key) {
+  FOR_EACH_OBSERVER(PrefStore::Observer, observers_, OnPrefValueChanged(key));
+  ScheduleWrite();
+}
+
+void FilePrefStore::SetValue(const std::string& key, base::Value* value) {
+  DCHECK(value);
+  scoped_ptr<base::Value> new_value(value);
+  base::Value* old_value = NULL;
+  prefs_->Get(key, &old_value);
+  if (old_value && value->Equals(old_value))
+    return;
+  prefs_->Set(key, new_value.release());
+  ReportValueChanged(key);
+}
+
+void FilePrefStore::SetValueSilently(const std::string& key,
+                                     base::Value* value) {
+  DCHECK(value);
+  scoped_ptr<base::Value> new_value(value);
+  base::Value* old_value = NULL;
+  prefs_->Get(key, &old_value);
+  if (old_value && value->Equals(old_value))
+    return;
+  prefs_->Set(key, new_value.release());
+  ScheduleWrite();
+}
+
+void FilePrefStore::RemoveValue(const std::string& key) {
+  if (prefs_->RemovePath(key, NULL))
+    ReportValueChanged(key);
+}
+
+bool FilePrefStore::ReadOnly() const {
+  return read_only_;
+}
+
+PersistentPrefStore::PrefReadError FilePrefStore::GetReadError() const {
+  return read_error_;
+}
+
+PersistentPrefStore::PrefReadError FilePrefStore::ReadPrefs() {
+  scoped_ptr<base::Value> value;
+  PrefReadError error = ReadPrefsFile(path_, &value);
+  FinishRead(value.Pass(), error);
+  return read_error_;
+}
+
+void FilePrefStore::ReadPrefsAsync(ReadErrorDelegate* error_delegate) {
+  error_delegate_.reset(error_delegate);
+
+  auto result = new ReadResult;
+  task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&FilePrefStore::ReadOnTaskRunner, path_, result),
+      base::Bind(&FilePrefStore::OnFileRead, this, base::Owned(result)));
+}
+
+void FilePrefStore::CommitPendingWrite() {
+  // Nothing is scheduled before the read has finished.
+  if (writer_.HasPendingWrite() && !read_only_)
+    writer_.DoScheduledWrite();
+}
+
+void FilePrefStore::ScheduleWrite() {
+  if (read_only_)
+    return;
+  if (!initialized_) {
+    dirty_before_read_ = true;
+    return;
+  }
+  writer_.ScheduleWrite(this);
+}
+
+bool FilePrefStore::SerializeData(std::string* output) {
+  JSONStringValueSerializer serializer(output);
+  serializer.set_pretty_print(true);
+  if (!serializer.Serialize(*prefs_))
+    return false;
+
+  auto now = base::TimeTicks::Now();
+  auto hour_ago = now - base::TimeDelta::FromHours(1);
+  while (!recent_writes_.empty() && recent_writes_.front().first < hour_ago)
+    recent_writes_.pop_front();
+  recent_writes_.push_back(std::make_pair(now, output->size()));
+  write_stats_.writes++;
+  write_stats_.bytes_written += output->size();
+  return true;
+}
+
+void FilePrefStore::OnFileRead(ReadResult* result) {
+  FinishRead(result->value.Pass(), result->error);
+}
+
+void FilePrefStore::FinishRead(scoped_ptr<base::Value> value,
+                               PrefReadError error) {
+  read_error_ = error;
+  // A missing file just means there are no prefs yet, and a corrupt one has
+  // been moved aside. If the file exists but can't be read, or a corrupt
+  // one couldn't be moved, don't overwrite it with defaults.
+  read_only_ = error == PREF_READ_ERROR_ACCESS_DENIED ||
+               error == PREF_READ_ERROR_FILE_LOCKED ||
+               error == PREF_READ_ERROR_FILE_OTHER;
+  if (value) {
+    // Values set while the file was being read win over the ones in it.
+    scoped_ptr<base::DictionaryValue> prefs(
+        static_cast<base::DictionaryValue*>(value.release()));
+    prefs->MergeDictionary(prefs_.get());
+    prefs_.swap(prefs);
+  }
+
+  initialized_ = true;
+  if (dirty_before_read_) {
+    dirty_before_read_ = false;
+    ScheduleWrite();
+  }
+  if (error_delegate_ && error != PREF_READ_ERROR_NONE)
+    error_delegate_->OnError(error);
+  error_delegate_.reset();
+
+  FOR_EACH_OBSERVER(PrefStore::Observer,
+                    observers_,
+                    OnInitializationCompleted(true));
+}
+
+}  // namespace brightray
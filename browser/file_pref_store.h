@@ -0,0 +1,108 @@
+#ifndef BRIGHTRAY_BROWSER_FILE_PREF_STORE_H_
+#define BRIGHTRAY_BROWSER_FILE_PREF_STORE_H_
+
+#include <deque>
+#include <utility>
+
+#include "base/files/file_path.h"
+#include "base/files/important_file_writer.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/observer_list.h"
+#include "base/prefs/persistent_pref_store.h"
+#include "base/time/time.h"
+
+namespace base {
+class DictionaryValue;
+class SequencedTaskRunner;
+}
+
+namespace brightray {
+
+// Counters for preference writes. Only accessed on the UI thread.
+struct PrefWriteStats {
+  PrefWriteStats()
+      : writes(0),
+        bytes_written(0),
+        bytes_written_last_hour(0) {
+  }
+
+  // Writes since the store was created. Changes made within one commit
+  // interval are coalesced into a single write.
+  int64 writes;
+  int64 bytes_written;
+  // Bytes written during the hour before the stats were taken.
+  int64 bytes_written_last_hour;
+};
+
+// A JSON file-backed pref store, like JsonPrefStore, that reads the file off
+// the UI thread and lets the caller choose how long changes are batched
+// before the file is rewritten. Writes are atomic: the file is written to a
+// temporary file on |task_runner| and then renamed over the old one.
+class FilePrefStore : public PersistentPrefStore,
+                      public base::ImportantFileWriter::DataSerializer {
+ public:
+  FilePrefStore(const base::FilePath& path,
+                base::SequencedTaskRunner* task_runner,
+                base::TimeDelta commit_interval);
+
+  PrefWriteStats write_stats() const;
+
+  // PrefStore:
+  virtual bool GetValue(const std::string& key,
+                        const base::Value** result) const OVERRIDE;
+  virtual void AddObserver(PrefStore::Observer* observer) OVERRIDE;
+  virtual void RemoveObserver(PrefStore::Observer* observer) OVERRIDE;
+  virtual bool HasObservers() const OVERRIDE;
+  virtual bool IsInitializationComplete() const OVERRIDE;
+
+  // PersistentPrefStore:
+  virtual bool GetMutableValue(const std::string& key,
+                               base::Value** result) OVERRIDE;
+  virtual void ReportValueChanged(const std::string& key) OVERRIDE;
+  virtual void SetValue(const std::string& key, base::Value* value) OVERRIDE;
+  virtual void SetValueSilently(const std::string& key,
+                                base::Value* value) OVERRIDE;
+  virtual void RemoveValue(const std::string& key) OVERRIDE;
+  virtual bool ReadOnly() const OVERRIDE;
+  virtual PrefReadError GetReadError() const OVERRIDE;
+  virtual PrefReadError ReadPrefs() OVERRIDE;
+  virtual void ReadPrefsAsync(ReadErrorDelegate* error_delegate) OVERRIDE;
+  virtual void CommitPendingWrite() OVERRIDE;
+
+  // base::ImportantFileWriter::DataSerializer:
+  virtual bool SerializeData(std::string* output) OVERRIDE;
+
+ private:
+  struct ReadResult;
+
+  virtual ~FilePrefStore();
+
+  static void ReadOnTaskRunner(const base::FilePath& path, ReadResult* result);
+  void OnFileRead(ReadResult* result);
+  void FinishRead(scoped_ptr<base::Value> value, PrefReadError error);
+  // Writing before the file has been read would replace it with only the
+  // values set so far, so until then changes are just remembered.
+  void ScheduleWrite();
+
+  base::FilePath path_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  scoped_ptr<base::DictionaryValue> prefs_;
+  bool read_only_;
+  bool initialized_;
+  // Set when a value changed before the file was read.
+  bool dirty_before_read_;
+  PrefReadError read_error_;
+  scoped_ptr<ReadErrorDelegate> error_delegate_;
+  base::ImportantFileWriter writer_;
+  ObserverList<PrefStore::Observer, true> observers_;
+
+  PrefWriteStats write_stats_;
+  // When each write in the last hour was serialized, and how large it was.
+  std::deque<std::pair<base::TimeTicks, size_t> > recent_writes_;
+
+  DISALLOW_COPY_AND_ASSIGN(FilePrefStore);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,76 @@
+#include "browser/in_memory_pref_store.h"
+
+#include "base/values.h"
+
+namespace brightray {
+
+InMemoryPrefStore::InMemoryPrefStore() {
+}
+
+InMemoryPrefStore::~InMemoryPrefStore() {
+}
+
+bool InMemoryPrefStore::GetValue(const std::string& key,
+                                 const base::Value** result) const {
+  return prefs_.GetValue(key, result);
+}
+
+void InMemoryPrefStore::AddObserver(PrefStore::Observer* observer) {
+  observers_.AddObserver(observer);
+}
+
+void InMemoryPrefStore::RemoveObserver(PrefStore::Observer* observer) {
+  observers_.RemoveObserver(observer);
+}
+
+bool InMemoryPrefStore::HasObservers() const {
+  return observers_.might_have_observers();
+}
+
+bool InMemoryPrefStore::IsInitializationComplete() const {
+  return true;
+}
+
+bool InMemoryPrefStore::GetMutableValue(const std::string& key,
+                                        base::Value** result) {
+  return prefs_.GetValue(key, result);
+}
+
+void InMemoryPrefStore::ReportValueChanged(const std::string& key) {
+  FOR_EACH_OBSERVER(PrefStore::Observer, observers_, OnPrefValueChanged(key));
+}
+
+void InMemoryPrefStore::SetValue(const std::string& key, base::Value* value) {
+  if (prefs_.SetValue(key, value))
+    ReportValueChanged(key);
+}
+
+void InMemoryPrefStore::SetValueSilently(const std::string& key,
+                                         base::Value* value) {
+  prefs_.SetValue(key, value);
+}
+
+void InMemoryPrefStore::RemoveValue(const std::string& key) {
+  if (prefs_.RemoveValue(key))
+    ReportValueChanged(key);
+}
+
+bool InMemoryPrefStore::ReadOnly() const {
+  return false;
+}
+
+PersistentPrefStore::PrefReadError InMemoryPrefStore::GetReadError() const {
+  return PersistentPrefStore::PREF_READ_ERROR_NONE;
+}
+
+PersistentPrefStore::PrefReadError InMemoryPrefStore::ReadPrefs() {
+  return PersistentPrefStore::PREF_READ_ERROR_NONE;
+}
+
+void InMemoryPrefStore::ReadPrefsAsync(ReadErrorDelegate* error_delegate) {
+  // There is nothing to read, and PrefService doesn't expect the delegate to
+  // be called when there is no error.
+  delete error_delegate;
+}
+
+}  // namespace brightray
@@ -22,4 +22,8 @@ InspectableWebContents* InspectableWebContents::Create(
   return new InspectableWebContentsImpl(web_contents);
 }
 
+void InspectableWebContents::SetMaxWarmDevToolsFrontends(size_t count) {
+  InspectableWebContentsImpl::SetMaxWarmFrontends(count);
+}
+
 }  // namespace brightray
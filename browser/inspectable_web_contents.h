@@ -17,6 +17,16 @@ class InspectableWebContents {
   // WebContents.
   static InspectableWebContents* Create(content::WebContents*);
 
+  // Lets up to |count| DevTools frontends stay loaded after CloseDevTools(),
+  // so that showing them again reuses their renderer and state instead of
+  // starting over. A hidden frontend stays attached to its page, but its
+  // breakpoints and pausing on exceptions are turned off and a paused page
+  // is resumed, so the page can't freeze while its DevTools aren't visible;
+  // they are turned back on when it is shown. The ones closed longest ago
+  // are destroyed first, and all of them are destroyed when
+  // base::MemoryPressureListener reports memory pressure. Defaults to 0.
+  static void SetMaxWarmDevToolsFrontends(size_t count);
+
   virtual ~InspectableWebContents() {}
 
   virtual InspectableWebContentsView* GetView() const = 0;
@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include "base/files/file_path.h"
+
 namespace brightray {
 
 class InspectableWebContentsDelegate {
@@ -21,6 +23,23 @@ class InspectableWebContentsDelegate {
   // Receiver is given the chance to change the |dock_side|.
   virtual bool DevToolsShow(std::string* dock_side) { return false; }
 
+  // Called when the devtools wants a folder to add to its workspace.
+  // Receiver should set |path| to the folder the user picked and return true,
+  // or return false if the user cancelled.
+  virtual bool DevToolsChooseFileSystemPath(base::FilePath* path) {
+    return false;
+  }
+
+  // Called when the devtools saves |url|. Receiver can set |path| and return
+  // true to have the file written on the FILE thread, gzip-compressed if
+  // |path| ends in ".gz", with later appends to |url| streamed into it.
+  // Otherwise DevToolsSaveToFile() and DevToolsAppendToFile() are called.
+  virtual bool DevToolsChooseSavePath(const std::string& url,
+                                      bool save_as,
+                                      base::FilePath* path) {
+    return false;
+  }
+
   // Requested by WebContents of devtools.
   virtual void DevToolsSaveToFile(
       const std::string& url, const std::string& content, bool save_as) {}
@@ -5,22 +5,34 @@
 
 #include "browser/inspectable_web_contents_impl.h"
 
+#include <algorithm>
+#include <list>
+
 #include "browser/browser_client.h"
 #include "browser/browser_context.h"
 #include "browser/browser_main_parts.h"
 #include "browser/inspectable_web_contents_delegate.h"
 #include "browser/inspectable_web_contents_view.h"
 
+#include "base/bind.h"
+#include "base/json/json_writer.h"
+#include "base/lazy_instance.h"
+#include "base/memory/memory_pressure_listener.h"
 #include "base/prefs/pref_registry_simple.h"
 #include "base/prefs/pref_service.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/values.h"
+#include "content/public/browser/child_process_security_policy.h"
 #include "content/public/browser/devtools_agent_host.h"
 #include "content/public/browser/devtools_client_host.h"
 #include "content/public/browser/devtools_http_handler.h"
 #include "content/public/browser/devtools_manager.h"
+#include "content/public/browser/render_process_host.h"
 #include "content/public/browser/web_contents_view.h"
 #include "content/public/browser/render_view_host.h"
+#include "webkit/browser/fileapi/isolated_context.h"
+#include "webkit/common/fileapi/file_system_util.h"
 
 namespace brightray {
 
@@ -28,6 +40,31 @@ namespace {
 
 const char kChromeUIDevToolsURL[] = "chrome-devtools://devtools/devtools.html";
 const char kDockSidePref[] = "brightray.devtools.dockside";
+const char kFileSystemPathsPref[] = "brightray.devtools.filesystempaths";
+
+// Run in a hidden frontend, these keep the debugger from pausing the page
+// while nothing is on screen to resume it, without changing the breakpoints
+// and settings the frontend shows.
+const char kSuspendDebuggerScript[] =
+    "if (window.DebuggerAgent) {"
+    "  DebuggerAgent.setBreakpointsActive(false);"
+    "  DebuggerAgent.setPauseOnExceptions(\"none\");"
+    "  DebuggerAgent.resume();"
+    "}";
+const char kRestoreDebuggerScript[] =
+    "if (window.DebuggerAgent && WebInspector.debuggerModel) {"
+    "  DebuggerAgent.setBreakpointsActive("
+    "      WebInspector.debuggerModel.breakpointsActive());"
+    "  DebuggerAgent.setPauseOnExceptions("
+    "      WebInspector.settings.pauseOnExceptionStateString.get());"
+    "}";
+
+// Instances whose DevTools are closed but still loaded, most recently
+// closed first.
+base::LazyInstance<std::list<InspectableWebContentsImpl*> >::Leaky
+    g_warm_frontends = LAZY_INSTANCE_INITIALIZER;
+size_t g_max_warm_frontends = 0;
+base::MemoryPressureListener* g_memory_pressure_listener = nullptr;
 
 }
 
@@ -37,20 +74,49 @@ InspectableWebContentsView* CreateInspectableContentsView(
 
 void InspectableWebContentsImpl::RegisterPrefs(PrefRegistrySimple* registry) {
   registry->RegisterStringPref(kDockSidePref, "bottom");
+  registry->RegisterListPref(kFileSystemPathsPref);
+}
+
+void InspectableWebContentsImpl::SetMaxWarmFrontends(size_t count) {
+  g_max_warm_frontends = count;
+
+  // Each warm frontend holds on to a renderer, which is worth more than a
+  // faster reopen when memory runs low.
+  if (g_max_warm_frontends && !g_memory_pressure_listener) {
+    g_memory_pressure_listener = new base::MemoryPressureListener(
+        base::Bind(&InspectableWebContentsImpl::OnMemoryPressure));
+  }
+
+  EvictWarmFrontends(g_max_warm_frontends);
+}
+
+void InspectableWebContentsImpl::EvictWarmFrontends(size_t keep) {
+  auto& warm_frontends = g_warm_frontends.Get();
+  while (warm_frontends.size() > keep) {
+    auto coldest = warm_frontends.back();
+    warm_frontends.pop_back();
+    coldest->devtools_web_contents_.reset();
+  }
+}
+
+void InspectableWebContentsImpl::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel level) {
+  EvictWarmFrontends(0);
 }
 
 InspectableWebContentsImpl::InspectableWebContentsImpl(
     content::WebContents* web_contents)
     : web_contents_(web_contents),
-      delegate_(nullptr) {
-  auto context = static_cast<BrowserContext*>(
-      web_contents_->GetBrowserContext());
-  dock_side_ = context->prefs()->GetString(kDockSidePref);
-
+      frontend_debugger_suspended_(false),
+      delegate_(nullptr),
+      weak_factory_(this) {
   view_.reset(CreateInspectableContentsView(this));
 }
 
 InspectableWebContentsImpl::~InspectableWebContentsImpl() {
+  StopKeepingFrontendWarm();
+  for (auto it = indexing_jobs_.begin(); it != indexing_jobs_.end(); ++it)
+    it->second->Stop();
 }
 
 InspectableWebContentsView* InspectableWebContentsImpl::GetView() const {
@@ -62,6 +128,10 @@ content::WebContents* InspectableWebContentsImpl::GetWebContents() const {
 }
 
 void InspectableWebContentsImpl::ShowDevTools() {
+  StopKeepingFrontendWarm();
+  if (frontend_debugger_suspended_)
+    RestoreFrontendDebugger();
+
   if (!devtools_web_contents_) {
     embedder_message_dispatcher_.reset(
         new DevToolsEmbedderMessageDispatcher(this));
@@ -94,6 +164,14 @@ void InspectableWebContentsImpl::ShowDevTools() {
         std::string());
   }
 
+  // Preferences are loaded asynchronously, so wait until they're needed to
+  // read the dock side.
+  if (dock_side_.empty()) {
+    auto context = static_cast<BrowserContext*>(
+        web_contents_->GetBrowserContext());
+    dock_side_ = context->prefs()->GetString(kDockSidePref);
+  }
+
   if (delegate_ && delegate_->DevToolsShow(&dock_side_))
     return;
 
@@ -104,7 +182,8 @@ void InspectableWebContentsImpl::ShowDevTools() {
 void InspectableWebContentsImpl::CloseDevTools() {
   if (IsDevToolsViewShowing()) {
     view_->CloseDevTools();
-    devtools_web_contents_.reset();
+    if (!KeepFrontendWarm())
+      devtools_web_contents_.reset();
     web_contents_->GetView()->Focus();
   }
 }
@@ -120,6 +199,182 @@ void InspectableWebContentsImpl::UpdateFrontendDockSide() {
       string16(), ASCIIToUTF16(javascript));
 }
 
+bool InspectableWebContentsImpl::KeepFrontendWarm() {
+  if (!g_max_warm_frontends)
+    return false;
+
+  // The frontend stays attached, so it's up to date when it is shown again
+  // and doesn't have to be reloaded.
+  devtools_web_contents_->GetRenderViewHost()->ExecuteJavascriptInWebFrame(
+      string16(), ASCIIToUTF16(kSuspendDebuggerScript));
+  frontend_debugger_suspended_ = true;
+
+  g_warm_frontends.Get().push_front(this);
+  EvictWarmFrontends(g_max_warm_frontends);
+  return true;
+}
+
+void InspectableWebContentsImpl::RestoreFrontendDebugger() {
+  frontend_debugger_suspended_ = false;
+  if (!devtools_web_contents_)
+    return;
+
+  devtools_web_contents_->GetRenderViewHost()->ExecuteJavascriptInWebFrame(
+      string16(), ASCIIToUTF16(kRestoreDebuggerScript));
+}
+
+void InspectableWebContentsImpl::StopKeepingFrontendWarm() {
+  g_warm_frontends.Get().remove(this);
+}
+
+void InspectableWebContentsImpl::CallClientFunction(
+    const std::string& function_name,
+    const base::Value* arg1,
+    const base::Value* arg2,
+    const base::Value* arg3) {
+  if (!devtools_web_contents_)
+    return;
+
+  std::string javascript = function_name + "(";
+  const base::Value* args[] = { arg1, arg2, arg3 };
+  for (size_t i = 0; i < arraysize(args) && args[i]; ++i) {
+    std::string json;
+    base::JSONWriter::Write(args[i], &json);
+    if (i)
+      javascript += ", ";
+    javascript += json;
+  }
+  javascript += ")";
+  devtools_web_contents_->GetRenderViewHost()->ExecuteJavascriptInWebFrame(
+      string16(), UTF8ToUTF16(javascript));
+}
+
+std::vector<base::FilePath> InspectableWebContentsImpl::GetFileSystemPaths() {
+  auto context = static_cast<BrowserContext*>(
+      web_contents_->GetBrowserContext());
+  auto list = context->prefs()->GetList(kFileSystemPathsPref);
+
+  std::vector<base::FilePath> paths;
+  for (size_t i = 0; i < list->GetSize(); ++i) {
+    std::string path;
+    if (list->GetString(i, &path))
+      paths.push_back(base::FilePath::FromUTF8Unsafe(path));
+  }
+  return paths;
+}
+
+void InspectableWebContentsImpl::SetFileSystemPaths(
+    const std::vector<base::FilePath>& paths) {
+  base::ListValue list;
+  for (auto it = paths.begin(); it != paths.end(); ++it)
+    list.AppendString(it->AsUTF8Unsafe());
+
+  auto context = static_cast<BrowserContext*>(
+      web_contents_->GetBrowserContext());
+  context->prefs()->Set(kFileSystemPathsPref, list);
+}
+
+bool InspectableWebContentsImpl::IsFileSystemAdded(
+    const base::FilePath& path) {
+  auto paths = GetFileSystemPaths();
+  return std::find(paths.begin(), paths.end(), path) != paths.end();
+}
+
+base::DictionaryValue* InspectableWebContentsImpl::CreateFileSystemValue(
+    const base::FilePath& path) {
+  std::string registered_name;
+  auto isolated_context = fileapi::IsolatedContext::GetInstance();
+  auto file_system_id = isolated_context->RegisterFileSystemForPath(
+      fileapi::kFileSystemTypeNativeLocal, path, &registered_name);
+
+  auto policy = content::ChildProcessSecurityPolicy::GetInstance();
+  int renderer_id =
+      devtools_web_contents_->GetRenderViewHost()->GetProcess()->GetID();
+  policy->GrantReadFileSystem(renderer_id, file_system_id);
+  policy->GrantWriteFileSystem(renderer_id, file_system_id);
+  policy->GrantCreateFileForFileSystem(renderer_id, file_system_id);
+  policy->GrantDeleteFromFileSystem(renderer_id, file_system_id);
+  if (!policy->CanReadFile(renderer_id, path))
+    policy->GrantReadFile(renderer_id, path);
+
+  auto origin = devtools_web_contents_->GetURL().GetOrigin();
+  auto file_system = new base::DictionaryValue;
+  file_system->SetString("fileSystemName",
+      fileapi::GetIsolatedFileSystemName(origin, file_system_id));
+  file_system->SetString("rootURL",
+      fileapi::GetIsolatedFileSystemRootURIString(
+          origin, file_system_id, registered_name));
+  file_system->SetString("fileSystemPath", path.AsUTF8Unsafe());
+  return file_system;
+}
+
+void InspectableWebContentsImpl::IndexingTotalWorkCalculated(
+    int request_id, const std::string& file_system_path, int total_work) {
+  base::FundamentalValue request_id_value(request_id);
+  base::StringValue file_system_path_value(file_system_path);
+  base::FundamentalValue total_work_value(total_work);
+  CallClientFunction("InspectorFrontendAPI.indexingTotalWorkCalculated",
+                     &request_id_value,
+                     &file_system_path_value,
+                     &total_work_value);
+}
+
+void InspectableWebContentsImpl::IndexingWorked(
+    int request_id, const std::string& file_system_path, int worked) {
+  base::FundamentalValue request_id_value(request_id);
+  base::StringValue file_system_path_value(file_system_path);
+  base::FundamentalValue worked_value(worked);
+  CallClientFunction("InspectorFrontendAPI.indexingWorked",
+                     &request_id_value,
+                     &file_system_path_value,
+                     &worked_value);
+}
+
+void InspectableWebContentsImpl::IndexingDone(
+    int request_id, const std::string& file_system_path) {
+  indexing_jobs_.erase(request_id);
+
+  base::FundamentalValue request_id_value(request_id);
+  base::StringValue file_system_path_value(file_system_path);
+  CallClientFunction("InspectorFrontendAPI.indexingDone",
+                     &request_id_value,
+                     &file_system_path_value,
+                     nullptr);
+}
+
+void InspectableWebContentsImpl::SearchCompleted(
+    int request_id,
+    const std::string& file_system_path,
+    const std::vector<std::string>& file_paths) {
+  base::ListValue file_paths_value;
+  for (auto it = file_paths.begin(); it != file_paths.end(); ++it)
+    file_paths_value.AppendString(*it);
+
+  base::FundamentalValue request_id_value(request_id);
+  base::StringValue file_system_path_value(file_system_path);
+  CallClientFunction("InspectorFrontendAPI.searchCompleted",
+                     &request_id_value,
+                     &file_system_path_value,
+                     &file_paths_value);
+}
+
+void InspectableWebContentsImpl::SavedToFile(const std::string& url,
+                                             bool success) {
+  base::StringValue url_value(url);
+  CallClientFunction(success ? "InspectorFrontendAPI.savedURL" :
+                               "InspectorFrontendAPI.canceledSaveURL",
+                     &url_value, nullptr, nullptr);
+}
+
+void InspectableWebContentsImpl::AppendedToFile(const std::string& url,
+                                                bool success) {
+  // The frontend has no way to hear about a failed append, and waits for
+  // this before sending the next chunk. The writer has logged the error.
+  base::StringValue url_value(url);
+  CallClientFunction("InspectorFrontendAPI.appendedToURL",
+                     &url_value, nullptr, nullptr);
+}
+
 void InspectableWebContentsImpl::ActivateWindow() {
 }
 
@@ -152,38 +407,128 @@ void InspectableWebContentsImpl::OpenInNewTab(const std::string& url) {
 }
 
 void InspectableWebContentsImpl::SaveToFile(
-    const std::string& url, const std::string& content, bool save_as) {
+    const std::string& url, std::string* content, bool save_as) {
+  base::FilePath path;
+  if (delegate_ && delegate_->DevToolsChooseSavePath(url, save_as, &path)) {
+    if (!file_writer_)
+      file_writer_ = new DevToolsFileWriter;
+    file_writer_->Save(url, path, content,
+        base::Bind(&InspectableWebContentsImpl::SavedToFile,
+                   weak_factory_.GetWeakPtr(), url));
+    return;
+  }
+
   if (delegate_)
-    delegate_->DevToolsSaveToFile(url, content, save_as);
+    delegate_->DevToolsSaveToFile(url, *content, save_as);
 }
 
 void InspectableWebContentsImpl::AppendToFile(
-    const std::string& url, const std::string& content) {
+    const std::string& url, std::string* content) {
+  if (file_writer_) {
+    if (file_writer_->Append(url, content,
+            base::Bind(&InspectableWebContentsImpl::AppendedToFile,
+                       weak_factory_.GetWeakPtr(), url)))
+      return;
+  }
+
   if (delegate_)
-    delegate_->DevToolsAppendToFile(url, content);
+    delegate_->DevToolsAppendToFile(url, *content);
 }
 
 void InspectableWebContentsImpl::RequestFileSystems() {
+  auto paths = GetFileSystemPaths();
+  base::ListValue file_systems;
+  for (auto it = paths.begin(); it != paths.end(); ++it)
+    file_systems.Append(CreateFileSystemValue(*it));
+  CallClientFunction("InspectorFrontendAPI.fileSystemsLoaded",
+                     &file_systems, nullptr, nullptr);
 }
 
 void InspectableWebContentsImpl::AddFileSystem() {
+  base::FilePath path;
+  if (!delegate_ || !delegate_->DevToolsChooseFileSystemPath(&path))
+    return;
+
+  if (!IsFileSystemAdded(path)) {
+    auto paths = GetFileSystemPaths();
+    paths.push_back(path);
+    SetFileSystemPaths(paths);
+  }
+
+  base::StringValue error_string("");
+  scoped_ptr<base::DictionaryValue> file_system(CreateFileSystemValue(path));
+  CallClientFunction("InspectorFrontendAPI.fileSystemAdded",
+                     &error_string, file_system.get(), nullptr);
 }
 
 void InspectableWebContentsImpl::RemoveFileSystem(
     const std::string& file_system_path) {
+  auto path = base::FilePath::FromUTF8Unsafe(file_system_path);
+  auto paths = GetFileSystemPaths();
+  auto it = std::find(paths.begin(), paths.end(), path);
+  if (it == paths.end())
+    return;
+  paths.erase(it);
+  SetFileSystemPaths(paths);
+
+  fileapi::IsolatedContext::GetInstance()->RevokeFileSystemByPath(path);
+  auto context = static_cast<BrowserContext*>(
+      web_contents_->GetBrowserContext());
+  context->GetDevToolsFileSystemIndexer()->RemovePath(path);
+
+  base::StringValue file_system_path_value(file_system_path);
+  CallClientFunction("InspectorFrontendAPI.fileSystemRemoved",
+                     &file_system_path_value, nullptr, nullptr);
 }
 
 void InspectableWebContentsImpl::IndexPath(
     int request_id, const std::string& file_system_path) {
+  auto path = base::FilePath::FromUTF8Unsafe(file_system_path);
+  // Only folders the user added may be read.
+  if (!IsFileSystemAdded(path)) {
+    IndexingDone(request_id, file_system_path);
+    return;
+  }
+
+  auto context = static_cast<BrowserContext*>(
+      web_contents_->GetBrowserContext());
+  auto weak_this = weak_factory_.GetWeakPtr();
+  indexing_jobs_[request_id] =
+      context->GetDevToolsFileSystemIndexer()->IndexPath(
+          path,
+          base::Bind(&InspectableWebContentsImpl::IndexingTotalWorkCalculated,
+                     weak_this, request_id, file_system_path),
+          base::Bind(&InspectableWebContentsImpl::IndexingWorked,
+                     weak_this, request_id, file_system_path),
+          base::Bind(&InspectableWebContentsImpl::IndexingDone,
+                     weak_this, request_id, file_system_path));
 }
 
 void InspectableWebContentsImpl::StopIndexing(int request_id) {
+  auto it = indexing_jobs_.find(request_id);
+  if (it == indexing_jobs_.end())
+    return;
+  it->second->Stop();
+  indexing_jobs_.erase(it);
 }
 
 void InspectableWebContentsImpl::SearchInPath(
     int request_id,
     const std::string& file_system_path,
     const std::string& query) {
+  auto path = base::FilePath::FromUTF8Unsafe(file_system_path);
+  if (!IsFileSystemAdded(path)) {
+    SearchCompleted(request_id, file_system_path, std::vector<std::string>());
+    return;
+  }
+
+  auto context = static_cast<BrowserContext*>(
+      web_contents_->GetBrowserContext());
+  context->GetDevToolsFileSystemIndexer()->SearchInPath(
+      path,
+      query,
+      base::Bind(&InspectableWebContentsImpl::SearchCompleted,
+                 weak_factory_.GetWeakPtr(), request_id, file_system_path));
 }
 
 void InspectableWebContentsImpl::DispatchOnEmbedder(
@@ -213,9 +558,22 @@ void InspectableWebContentsImpl::DidFinishLoad(int64 frame_id,
 void InspectableWebContentsImpl::WebContentsDestroyed(content::WebContents*) {
   content::DevToolsManager::GetInstance()->ClientHostClosing(
       frontend_host_.get());
+  frontend_debugger_suspended_ = false;
   Observe(nullptr);
   agent_host_ = nullptr;
   frontend_host_.reset();
+
+  // This can happen while the dispatcher is handling a batch of messages,
+  // which stops it from handling the rest against the closed frontend.
+  embedder_message_dispatcher_.reset();
+
+  // Nothing is left to report indexing progress to.
+  for (auto it = indexing_jobs_.begin(); it != indexing_jobs_.end(); ++it)
+    it->second->Stop();
+  indexing_jobs_.clear();
+
+  // Closes and completes the saved files once their data is written.
+  file_writer_ = nullptr;
 }
 
 void InspectableWebContentsImpl::HandleKeyboardEvent(
@@ -8,7 +8,15 @@
 
 #include "browser/inspectable_web_contents.h"
 
+#include <map>
+#include <vector>
+
 #include "browser/devtools_embedder_message_dispatcher.h"
+#include "browser/devtools_file_system_indexer.h"
+#include "browser/devtools_file_writer.h"
+
+#include "base/memory/memory_pressure_listener.h"
+#include "base/memory/weak_ptr.h"
 
 #include "content/public/browser/devtools_frontend_host_delegate.h"
 #include "content/public/browser/web_contents_delegate.h"
@@ -16,6 +24,11 @@
 
 class PrefRegistrySimple;
 
+namespace base {
+class DictionaryValue;
+class Value;
+}
+
 namespace content {
 class DevToolsAgentHost;
 class DevToolsClientHost;
@@ -34,6 +47,7 @@ class InspectableWebContentsImpl :
     DevToolsEmbedderMessageDispatcher::Delegate {
  public:
   static void RegisterPrefs(PrefRegistrySimple* pref_registry);
+  static void SetMaxWarmFrontends(size_t count);
 
   explicit InspectableWebContentsImpl(content::WebContents*);
   virtual ~InspectableWebContentsImpl();
@@ -56,6 +70,50 @@ class InspectableWebContentsImpl :
  private:
   void UpdateFrontendDockSide();
 
+  // Destroys the frontends of all but the |keep| most recently warmed
+  // instances.
+  static void EvictWarmFrontends(size_t keep);
+  static void OnMemoryPressure(
+      base::MemoryPressureListener::MemoryPressureLevel level);
+
+  // Keeps the hidden frontend around if the warm frontend limit allows it,
+  // evicting the coldest ones to make room, and stops its debugger from
+  // pausing the page. Returns false if it should be destroyed instead.
+  bool KeepFrontendWarm();
+  // Lets a warm frontend's breakpoints and exception settings take effect
+  // again.
+  void RestoreFrontendDebugger();
+  // Takes us out of the set of warm frontends.
+  void StopKeepingFrontendWarm();
+
+  // Calls |function_name| in the frontend with the given arguments, which
+  // may be null to leave them out.
+  void CallClientFunction(const std::string& function_name,
+                          const base::Value* arg1,
+                          const base::Value* arg2,
+                          const base::Value* arg3);
+
+  // Returns the folders added to the DevTools workspace.
+  std::vector<base::FilePath> GetFileSystemPaths();
+  void SetFileSystemPaths(const std::vector<base::FilePath>& paths);
+  bool IsFileSystemAdded(const base::FilePath& path);
+  // Gives the frontend access to |path| and describes it the way
+  // InspectorFrontendAPI expects.
+  base::DictionaryValue* CreateFileSystemValue(const base::FilePath& path);
+
+  void IndexingTotalWorkCalculated(int request_id,
+                                   const std::string& file_system_path,
+                                   int total_work);
+  void IndexingWorked(int request_id,
+                      const std::string& file_system_path,
+                      int worked);
+  void IndexingDone(int request_id, const std::string& file_system_path);
+  void SearchCompleted(int request_id,
+                       const std::string& file_system_path,
+                       const std::vector<std::string>& file_paths);
+  void SavedToFile(const std::string& url, bool success);
+  void AppendedToFile(const std::string& url, bool success);
+
   // DevToolsEmbedderMessageDispacher::Delegate
 
   virtual void ActivateWindow() OVERRIDE;
@@ -64,10 +122,10 @@ class InspectableWebContentsImpl :
   virtual void SetDockSide(const std::string& side) OVERRIDE;
   virtual void OpenInNewTab(const std::string& url) OVERRIDE;
   virtual void SaveToFile(const std::string& url,
-                          const std::string& content,
+                          std::string* content,
                           bool save_as) OVERRIDE;
   virtual void AppendToFile(const std::string& url,
-                            const std::string& content) OVERRIDE;
+                            std::string* content) OVERRIDE;
   virtual void RequestFileSystems() OVERRIDE;
   virtual void AddFileSystem() OVERRIDE;
   virtual void RemoveFileSystem(const std::string& file_system_path) OVERRIDE;
@@ -103,12 +161,23 @@ class InspectableWebContentsImpl :
   scoped_ptr<content::WebContents> devtools_web_contents_;
   scoped_ptr<InspectableWebContentsView> view_;
   scoped_refptr<content::DevToolsAgentHost> agent_host_;
+  // Whether the frontend's debugger was suspended while it was kept warm.
+  bool frontend_debugger_suspended_;
   std::string dock_side_;
 
   scoped_ptr<DevToolsEmbedderMessageDispatcher> embedder_message_dispatcher_;
 
+  typedef std::map<int, scoped_refptr<DevToolsFileSystemIndexer::IndexingJob> >
+      IndexingJobsMap;
+  IndexingJobsMap indexing_jobs_;
+
+  // Created by the first save the delegate picks a path for.
+  scoped_refptr<DevToolsFileWriter> file_writer_;
+
   InspectableWebContentsDelegate* delegate_;
 
+  base::WeakPtrFactory<InspectableWebContentsImpl> weak_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(InspectableWebContentsImpl);
 };
 
@@ -0,0 +1,120 @@
+#include "browser/isolated_url_request_context_getter.h"
+
+#include <algorithm>
+
+#include "browser/net/tiered_cache_backend.h"
+#include "browser/url_request_context_getter.h"
+
+#include "base/threading/worker_pool.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/browser/cookie_store_factory.h"
+#include "net/cookies/cookie_monster.h"
+#include "net/http/http_cache.h"
+#include "net/http/http_network_session.h"
+#include "net/http/transport_security_state.h"
+#include "net/ssl/default_server_bound_cert_store.h"
+#include "net/ssl/server_bound_cert_service.h"
+#include "net/url_request/url_request_context.h"
+#include "net/url_request/url_request_context_storage.h"
+
+using content::BrowserThread;
+
+namespace brightray {
+
+IsolatedURLRequestContextGetter::IsolatedURLRequestContextGetter(
+    URLRequestContextGetter* main_getter,
+    const base::FilePath& partition_path,
+    bool in_memory,
+    const HttpCacheConfig& http_cache_config,
+    content::ProtocolHandlerMap* protocol_handlers)
+    : main_getter_(main_getter),
+      partition_path_(partition_path),
+      in_memory_(in_memory),
+      http_cache_config_(http_cache_config) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  DCHECK(!in_memory_ ||
+         http_cache_config_.mode == HttpCacheConfig::MODE_MEMORY);
+
+  std::swap(protocol_handlers_, *protocol_handlers);
+}
+
+IsolatedURLRequestContextGetter::~IsolatedURLRequestContextGetter() {
+}
+
+net::URLRequestContext*
+    IsolatedURLRequestContextGetter::GetURLRequestContext() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  if (!url_request_context_) {
+    auto main_context = main_getter_->GetURLRequestContext();
+
+    // Start from the main context's pointers and replace the parts that hold
+    // per-partition state.
+    url_request_context_.reset(new net::URLRequestContext);
+    url_request_context_->CopyFrom(main_context);
+    storage_.reset(
+        new net::URLRequestContextStorage(url_request_context_.get()));
+
+    if (in_memory_) {
+      storage_->set_cookie_store(new net::CookieMonster(nullptr, nullptr));
+    } else {
+      storage_->set_cookie_store(content::CreatePersistentCookieStore(
+          partition_path_.Append(FILE_PATH_LITERAL("Cookies")),
+          false,
+          nullptr,
+          nullptr,
+          nullptr));
+    }
+
+    if (!in_memory_) {
+      server_bound_cert_persistent_store_ = new SQLiteServerBoundCertStore(
+          partition_path_.Append(FILE_PATH_LITERAL("Origin Bound Certs")),
+          BrowserThread::GetMessageLoopProxyForThread(BrowserThread::DB));
+    }
+    storage_->set_server_bound_cert_service(new net::ServerBoundCertService(
+        new net::DefaultServerBoundCertStore(
+            server_bound_cert_persistent_store_.get()),
+        base::WorkerPool::GetTaskRunner(true)));
+
+    auto transport_security_state = new net::TransportSecurityState;
+    storage_->set_transport_security_state(transport_security_state);
+    if (in_memory_) {
+      AddHSTSPreloads(transport_security_state, main_getter_->hsts_preloads());
+    } else {
+      transport_security_persister_.reset(new TransportSecurityPersister(
+          transport_security_state,
+          partition_path_,
+          BrowserThread::GetMessageLoopProxyForThread(BrowserThread::FILE),
+          main_getter_->hsts_preloads()));
+    }
+
+    // A session with the main session's parameters, except for the state
+    // that belongs to this partition.
+    auto main_session = main_context->http_transaction_factory()->GetSession();
+    net::HttpNetworkSession::Params session_params = main_session->params();
+    session_params.server_bound_cert_service =
+        url_request_context_->server_bound_cert_service();
+    session_params.transport_security_state =
+        url_request_context_->transport_security_state();
+
+    auto backend = new TieredCacheBackendFactory(
+        http_cache_config_,
+        partition_path_.Append(FILE_PATH_LITERAL("Cache")),
+        BrowserThread::GetMessageLoopProxyForThread(BrowserThread::CACHE),
+        &http_cache_stats_);
+    storage_->set_http_transaction_factory(
+        new net::HttpCache(session_params, backend));
+
+    storage_->set_job_factory(
+        URLRequestContextGetter::CreateJobFactory(&protocol_handlers_));
+  }
+
+  return url_request_context_.get();
+}
+
+scoped_refptr<base::SingleThreadTaskRunner>
+    IsolatedURLRequestContextGetter::GetNetworkTaskRunner() const {
+  return BrowserThread::GetMessageLoopProxyForThread(BrowserThread::IO);
+}
+
+}  // namespace brightray
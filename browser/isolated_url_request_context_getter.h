@@ -0,0 +1,74 @@
+#ifndef BRIGHTRAY_BROWSER_ISOLATED_URL_REQUEST_CONTEXT_GETTER_H_
+#define BRIGHTRAY_BROWSER_ISOLATED_URL_REQUEST_CONTEXT_GETTER_H_
+
+#include "browser/net/http_cache_config.h"
+#include "browser/net/sqlite_server_bound_cert_store.h"
+#include "browser/net/transport_security_persister.h"
+
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
+#include "content/public/browser/content_browser_client.h"
+#include "net/url_request/url_request_context_getter.h"
+
+namespace net {
+class URLRequestContextStorage;
+}
+
+namespace brightray {
+
+class URLRequestContextGetter;
+
+// The request context of a storage partition. It has its own cookie jar,
+// HTTP cache, server-bound certs, HSTS state and protocol handlers, and
+// borrows everything else from the main context: the host resolver, cert
+// verifier, proxy service, HTTP server properties and network delegate.
+// Since the HttpNetworkSession carries the server-bound cert service and
+// the HSTS state, each partition builds its own session from the main
+// session's parameters, so partitions don't share sockets. All of this is
+// only created once the partition makes a request.
+class IsolatedURLRequestContextGetter : public net::URLRequestContextGetter {
+ public:
+  // Cookies, the cache, server-bound certs and HSTS state are kept under
+  // |partition_path|, or only in memory if |in_memory| is true.
+  IsolatedURLRequestContextGetter(
+      URLRequestContextGetter* main_getter,
+      const base::FilePath& partition_path,
+      bool in_memory,
+      const HttpCacheConfig&,
+      content::ProtocolHandlerMap*);
+  virtual ~IsolatedURLRequestContextGetter();
+
+  // Must be called on the IO thread.
+  const HttpCacheStats& http_cache_stats() const { return http_cache_stats_; }
+
+  virtual net::URLRequestContext* GetURLRequestContext() OVERRIDE;
+
+ private:
+  virtual scoped_refptr<base::SingleThreadTaskRunner>
+      GetNetworkTaskRunner() const OVERRIDE;
+
+  // Keeps the shared parts of the network stack alive.
+  scoped_refptr<URLRequestContextGetter> main_getter_;
+  base::FilePath partition_path_;
+  bool in_memory_;
+  HttpCacheConfig http_cache_config_;
+
+  // Declared before |storage_| since the cache backend writes to it until
+  // it is destroyed.
+  HttpCacheStats http_cache_stats_;
+
+  // Null when |in_memory_|.
+  scoped_refptr<SQLiteServerBoundCertStore> server_bound_cert_persistent_store_;
+  scoped_ptr<net::URLRequestContextStorage> storage_;
+  scoped_ptr<net::URLRequestContext> url_request_context_;
+  // Declared after |storage_| so it's destroyed before the state it watches.
+  // Null when |in_memory_|.
+  scoped_ptr<TransportSecurityPersister> transport_security_persister_;
+  content::ProtocolHandlerMap protocol_handlers_;
+
+  DISALLOW_COPY_AND_ASSIGN(IsolatedURLRequestContextGetter);
+};
+
+}  // namespace brightray
+
+#endif
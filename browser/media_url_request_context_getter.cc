@@ -0,0 +1,56 @@
+#include "browser/media_url_request_context_getter.h"
+
+#include "browser/net/tiered_cache_backend.h"
+
+#include "content/public/browser/browser_thread.h"
+#include "net/http/http_cache.h"
+#include "net/http/http_network_session.h"
+#include "net/url_request/url_request_context.h"
+#include "net/url_request/url_request_context_storage.h"
+
+using content::BrowserThread;
+
+namespace brightray {
+
+MediaURLRequestContextGetter::MediaURLRequestContextGetter(
+    net::URLRequestContextGetter* base_getter,
+    const base::FilePath& cache_path,
+    const HttpCacheConfig& http_cache_config)
+    : base_getter_(base_getter),
+      cache_path_(cache_path),
+      http_cache_config_(http_cache_config) {
+}
+
+MediaURLRequestContextGetter::~MediaURLRequestContextGetter() {
+}
+
+net::URLRequestContext* MediaURLRequestContextGetter::GetURLRequestContext() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  if (!url_request_context_) {
+    auto base_context = base_getter_->GetURLRequestContext();
+
+    url_request_context_.reset(new net::URLRequestContext);
+    url_request_context_->CopyFrom(base_context);
+    storage_.reset(
+        new net::URLRequestContextStorage(url_request_context_.get()));
+
+    auto backend = new TieredCacheBackendFactory(
+        http_cache_config_,
+        cache_path_,
+        BrowserThread::GetMessageLoopProxyForThread(BrowserThread::CACHE),
+        &http_cache_stats_);
+    auto session = base_context->http_transaction_factory()->GetSession();
+    storage_->set_http_transaction_factory(
+        new net::HttpCache(session, backend));
+  }
+
+  return url_request_context_.get();
+}
+
+scoped_refptr<base::SingleThreadTaskRunner>
+    MediaURLRequestContextGetter::GetNetworkTaskRunner() const {
+  return BrowserThread::GetMessageLoopProxyForThread(BrowserThread::IO);
+}
+
+}  // namespace brightray
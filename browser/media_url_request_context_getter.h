@@ -0,0 +1,54 @@
+#ifndef BRIGHTRAY_BROWSER_MEDIA_URL_REQUEST_CONTEXT_GETTER_H_
+#define BRIGHTRAY_BROWSER_MEDIA_URL_REQUEST_CONTEXT_GETTER_H_
+
+#include "browser/net/http_cache_config.h"
+
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
+#include "net/url_request/url_request_context_getter.h"
+
+namespace net {
+class URLRequestContextStorage;
+}
+
+namespace brightray {
+
+// The request context for audio and video. It is the same as |base_getter|'s
+// context (cookies, network session and all), except that responses are
+// cached in a separate HTTP cache with its own size limit, so large media
+// range requests don't evict the page's own resources.
+class MediaURLRequestContextGetter : public net::URLRequestContextGetter {
+ public:
+  // The cache is kept at |cache_path| unless |http_cache_config| uses
+  // MODE_MEMORY.
+  MediaURLRequestContextGetter(net::URLRequestContextGetter* base_getter,
+                               const base::FilePath& cache_path,
+                               const HttpCacheConfig& http_cache_config);
+  virtual ~MediaURLRequestContextGetter();
+
+  // Must be called on the IO thread.
+  const HttpCacheStats& http_cache_stats() const { return http_cache_stats_; }
+
+  virtual net::URLRequestContext* GetURLRequestContext() OVERRIDE;
+
+ private:
+  virtual scoped_refptr<base::SingleThreadTaskRunner>
+      GetNetworkTaskRunner() const OVERRIDE;
+
+  scoped_refptr<net::URLRequestContextGetter> base_getter_;
+  base::FilePath cache_path_;
+  HttpCacheConfig http_cache_config_;
+
+  // Declared before |storage_| since the cache backend writes to it until
+  // it is destroyed.
+  HttpCacheStats http_cache_stats_;
+
+  scoped_ptr<net::URLRequestContextStorage> storage_;
+  scoped_ptr<net::URLRequestContext> url_request_context_;
+
+  DISALLOW_COPY_AND_ASSIGN(MediaURLRequestContextGetter);
+};
+
+}  // namespace brightray
+
+#endif
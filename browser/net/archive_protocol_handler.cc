@@ -0,0 +1,109 @@
+#include "browser/net/archive_protocol_handler.h"
+
+#include "browser/net/resource_archive.h"
+#include "browser/net/url_request_mapped_job.h"
+
+#include "base/bind.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_loop.h"
+#include "base/task_runner_util.h"
+#include "content/public/browser/browser_thread.h"
+#include "net/base/escape.h"
+#include "net/base/net_errors.h"
+#include "net/url_request/url_request.h"
+
+using content::BrowserThread;
+
+namespace brightray {
+
+namespace {
+
+const char kDefaultResource[] = "index.html";
+
+class URLRequestArchiveJob : public URLRequestMappedJob {
+ public:
+  // Entries are small and were paged in when the archive was opened, so
+  // they are copied without leaving the IO thread.
+  URLRequestArchiveJob(net::URLRequest* request,
+                       net::NetworkDelegate* network_delegate,
+                       ResourceArchive* archive)
+      : URLRequestMappedJob(request, network_delegate, nullptr),
+        archive_(archive),
+        weak_factory_(this) {
+  }
+
+  virtual void Start() OVERRIDE {
+    // Jobs must not complete synchronously from Start(). Only the first
+    // requests have to wait for the archive to be mapped; after that, Open()
+    // just returns the result without blocking.
+    if (archive_->IsOpenFinished()) {
+      base::MessageLoop::current()->PostTask(
+          FROM_HERE,
+          base::Bind(&URLRequestArchiveJob::OnArchiveOpened,
+                     weak_factory_.GetWeakPtr(),
+                     archive_->Open()));
+      return;
+    }
+
+    base::PostTaskAndReplyWithResult(
+        BrowserThread::GetMessageLoopProxyForThread(BrowserThread::FILE),
+        FROM_HERE,
+        base::Bind(&ResourceArchive::Open, archive_),
+        base::Bind(&URLRequestArchiveJob::OnArchiveOpened,
+                   weak_factory_.GetWeakPtr()));
+  }
+
+  virtual void Kill() OVERRIDE {
+    weak_factory_.InvalidateWeakPtrs();
+    URLRequestMappedJob::Kill();
+  }
+
+ private:
+  virtual ~URLRequestArchiveJob() {}
+
+  void OnArchiveOpened(bool opened) {
+    if (!opened) {
+      OnDataFailed(net::ERR_FILE_NOT_FOUND);
+      return;
+    }
+
+    auto path = net::UnescapeURLComponent(
+        request()->url().path(),
+        net::UnescapeRule::SPACES | net::UnescapeRule::URL_SPECIAL_CHARS);
+    if (!path.empty() && path[0] == '/')
+      path.erase(0, 1);
+    if (path.empty())
+      path = kDefaultResource;
+
+    ResourceArchive::Entry entry;
+    if (!archive_->Find(path, &entry)) {
+      OnDataFailed(net::ERR_FILE_NOT_FOUND);
+      return;
+    }
+    OnDataReady(entry.data, archive_, entry.mime_type.as_string(),
+                entry.gzipped);
+  }
+
+  scoped_refptr<ResourceArchive> archive_;
+  base::WeakPtrFactory<URLRequestArchiveJob> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLRequestArchiveJob);
+};
+
+}  // namespace
+
+ArchiveProtocolHandler::ArchiveProtocolHandler(
+    const base::FilePath& archive_path)
+    : archive_(new ResourceArchive(archive_path)) {
+}
+
+ArchiveProtocolHandler::~ArchiveProtocolHandler() {
+}
+
+net::URLRequestJob* ArchiveProtocolHandler::MaybeCreateJob(
+    net::URLRequest* request,
+    net::NetworkDelegate* network_delegate) const {
+  return new URLRequestArchiveJob(request, network_delegate, archive_.get());
+}
+
+}  // namespace brightray
@@ -0,0 +1,44 @@
+#ifndef BRIGHTRAY_BROWSER_NET_ARCHIVE_PROTOCOL_HANDLER_H_
+#define BRIGHTRAY_BROWSER_NET_ARCHIVE_PROTOCOL_HANDLER_H_
+
+#include "base/memory/ref_counted.h"
+#include "net/url_request/url_request_job_factory.h"
+
+namespace base {
+class FilePath;
+}
+
+namespace brightray {
+
+class ResourceArchive;
+
+// Serves the resources in an archive built by tools/pack_archive.py. The
+// path of the URL (without the leading slash) names the resource, and an
+// empty path serves "index.html". Install it from
+// BrowserClient::CreateRequestContext():
+//
+//   (*protocol_handlers)["app"] = linked_ptr<ProtocolHandler>(
+//       new ArchiveProtocolHandler(app_archive_path));
+//
+// The archive is memory-mapped on the FILE thread the first time it is
+// needed; after that, requests are answered without any file system calls.
+class ArchiveProtocolHandler
+    : public net::URLRequestJobFactory::ProtocolHandler {
+ public:
+  explicit ArchiveProtocolHandler(const base::FilePath& archive_path);
+  virtual ~ArchiveProtocolHandler();
+
+  // net::URLRequestJobFactory::ProtocolHandler:
+  virtual net::URLRequestJob* MaybeCreateJob(
+      net::URLRequest* request,
+      net::NetworkDelegate* network_delegate) const OVERRIDE;
+
+ private:
+  scoped_refptr<ResourceArchive> archive_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArchiveProtocolHandler);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,127 @@
+#include "browser/net/caching_proxy_resolver.h"
+
+#include "base/bind.h"
+#include "net/base/net_errors.h"
+#include "url/gurl.h"
+
+namespace brightray {
+
+namespace {
+
+// Keeps a burst of unique hosts from growing the cache without bound.
+const size_t kMaxCachedResults = 1024;
+
+std::string GetCacheKey(const GURL& url) {
+  return url.GetOrigin().spec();
+}
+
+}  // namespace
+
+CachingProxyResolver::CachingProxyResolver(const Factory& factory,
+                                           base::TimeDelta time_to_live,
+                                           ProxyResolverStats* stats)
+    : net::ProxyResolver(true),
+      factory_(factory),
+      time_to_live_(time_to_live),
+      stats_(stats),
+      generation_(0),
+      weak_factory_(this) {
+  DCHECK(stats_);
+}
+
+CachingProxyResolver::~CachingProxyResolver() {
+}
+
+int CachingProxyResolver::GetProxyForURL(
+    const GURL& url,
+    net::ProxyInfo* results,
+    const net::CompletionCallback& callback,
+    RequestHandle* request,
+    const net::BoundNetLog& net_log) {
+  // ProxyService only asks for proxies after a script has been set.
+  if (!resolver_)
+    return net::ERR_FAILED;
+
+  auto key = GetCacheKey(url);
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    if (base::TimeTicks::Now() < it->second.expiration) {
+      ++stats_->hits;
+      results->Use(it->second.info);
+      return net::OK;
+    }
+    cache_.erase(it);
+  }
+
+  ++stats_->misses;
+  int rv = resolver_->GetProxyForURL(
+      url,
+      results,
+      base::Bind(&CachingProxyResolver::OnProxyResolved,
+                 weak_factory_.GetWeakPtr(),
+                 generation_,
+                 key,
+                 results,
+                 callback),
+      request,
+      net_log);
+  if (rv == net::OK)
+    StoreResult(key, *results);
+  return rv;
+}
+
+void CachingProxyResolver::CancelRequest(RequestHandle request) {
+  resolver_->CancelRequest(request);
+}
+
+net::LoadState CachingProxyResolver::GetLoadState(
+    RequestHandle request) const {
+  return resolver_->GetLoadState(request);
+}
+
+void CachingProxyResolver::CancelSetPacScript() {
+  if (resolver_)
+    resolver_->CancelSetPacScript();
+}
+
+void CachingProxyResolver::PurgeMemory() {
+  cache_.clear();
+  if (resolver_)
+    resolver_->PurgeMemory();
+}
+
+int CachingProxyResolver::SetPacScript(
+    const scoped_refptr<net::ProxyResolverScriptData>& script_data,
+    const net::CompletionCallback& callback) {
+  cache_.clear();
+  ++generation_;
+
+  if (!resolver_) {
+    resolver_ = factory_.Run().Pass();
+    DCHECK(resolver_->expects_pac_bytes());
+  }
+  return resolver_->SetPacScript(script_data, callback);
+}
+
+void CachingProxyResolver::OnProxyResolved(
+    int generation,
+    const std::string& key,
+    net::ProxyInfo* results,
+    const net::CompletionCallback& callback,
+    int result) {
+  if (result == net::OK && generation == generation_)
+    StoreResult(key, *results);
+  callback.Run(result);
+}
+
+void CachingProxyResolver::StoreResult(const std::string& key,
+                                       const net::ProxyInfo& info) {
+  if (cache_.size() >= kMaxCachedResults)
+    cache_.clear();
+
+  CachedResult& cached = cache_[key];
+  cached.info.Use(info);
+  cached.expiration = base::TimeTicks::Now() + time_to_live_;
+}
+
+}  // namespace brightray
@@ -0,0 +1,88 @@
+#ifndef BRIGHTRAY_BROWSER_NET_CACHING_PROXY_RESOLVER_H_
+#define BRIGHTRAY_BROWSER_NET_CACHING_PROXY_RESOLVER_H_
+
+#include <map>
+#include <string>
+
+#include "base/callback.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "net/proxy/proxy_info.h"
+#include "net/proxy/proxy_resolver.h"
+
+namespace brightray {
+
+// Counters for PAC lookups. Only accessed on the IO thread.
+struct ProxyResolverStats {
+  ProxyResolverStats() : hits(0), misses(0) {}
+
+  // Lookups answered from the cache without evaluating the PAC script.
+  int64 hits;
+  // Lookups that had to run the PAC script.
+  int64 misses;
+};
+
+// A net::ProxyResolver that remembers the result of evaluating the PAC script
+// for each scheme, host and port for a while.
+//
+// The resolver that actually runs the script is only created once a PAC
+// script is set, so configurations that never use PAC or WPAD don't pay for
+// it at all.
+class CachingProxyResolver : public net::ProxyResolver {
+ public:
+  typedef base::Callback<scoped_ptr<net::ProxyResolver>(void)> Factory;
+
+  // |stats| must outlive the resolver.
+  CachingProxyResolver(const Factory& factory,
+                       base::TimeDelta time_to_live,
+                       ProxyResolverStats* stats);
+  virtual ~CachingProxyResolver();
+
+  // net::ProxyResolver:
+  virtual int GetProxyForURL(const GURL& url,
+                             net::ProxyInfo* results,
+                             const net::CompletionCallback& callback,
+                             RequestHandle* request,
+                             const net::BoundNetLog& net_log) OVERRIDE;
+  virtual void CancelRequest(RequestHandle request) OVERRIDE;
+  virtual net::LoadState GetLoadState(RequestHandle request) const OVERRIDE;
+  virtual void CancelSetPacScript() OVERRIDE;
+  virtual void PurgeMemory() OVERRIDE;
+  virtual int SetPacScript(
+      const scoped_refptr<net::ProxyResolverScriptData>& script_data,
+      const net::CompletionCallback& callback) OVERRIDE;
+
+ private:
+  struct CachedResult {
+    net::ProxyInfo info;
+    base::TimeTicks expiration;
+  };
+  typedef std::map<std::string, CachedResult> Cache;
+
+  void OnProxyResolved(int generation,
+                       const std::string& key,
+                       net::ProxyInfo* results,
+                       const net::CompletionCallback& callback,
+                       int result);
+  void StoreResult(const std::string& key, const net::ProxyInfo& info);
+
+  Factory factory_;
+  base::TimeDelta time_to_live_;
+  ProxyResolverStats* stats_;
+
+  scoped_ptr<net::ProxyResolver> resolver_;
+  Cache cache_;
+
+  // Incremented every time the PAC script changes, so lookups that were
+  // started with the old script don't end up in the cache.
+  int generation_;
+
+  base::WeakPtrFactory<CachingProxyResolver> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(CachingProxyResolver);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef BRIGHTRAY_BROWSER_NET_HTTP_CACHE_CONFIG_H_
+#define BRIGHTRAY_BROWSER_NET_HTTP_CACHE_CONFIG_H_
+
+#include "base/basictypes.h"
+#include "net/base/cache_type.h"
+
+namespace brightray {
+
+// Describes where the HTTP cache keeps its entries and how large each tier is
+// allowed to grow.
+struct HttpCacheConfig {
+  enum Mode {
+    // Entries live only on disk under <profile>/Cache.
+    MODE_DISK,
+    // Entries live only in memory and are lost when the process exits.
+    MODE_MEMORY,
+    // Entries are kept on disk, and recently used ones are also kept in a
+    // memory tier that is consulted first.
+    MODE_TIERED,
+  };
+
+  HttpCacheConfig()
+      : mode(MODE_DISK),
+        disk_cache_type(net::DISK_CACHE),
+        disk_backend_type(net::CACHE_BACKEND_DEFAULT),
+        memory_max_bytes(0),
+        disk_max_bytes(0) {
+  }
+
+  Mode mode;
+
+  // What the on-disk tier holds. MEDIA_CACHE makes the backend size and
+  // evict for a few large, range-requested entries instead of many small
+  // ones.
+  net::CacheType disk_cache_type;
+
+  // The on-disk format. CACHE_BACKEND_SIMPLE opens faster and has lower
+  // per-request latency than the blockfile cache, especially on Linux. An
+  // existing cache in a different format is discarded the first time it is
+  // opened with another backend type.
+  net::BackendType disk_backend_type;
+
+  // Byte budgets for each tier. The backend evicts entries to stay below
+  // them. 0 lets the backend pick a size based on the available memory or
+  // disk space.
+  int memory_max_bytes;
+  int disk_max_bytes;
+};
+
+// Lookup counters for the HTTP cache, split by the tier that answered.
+// Only accessed on the IO thread.
+struct HttpCacheStats {
+  HttpCacheStats()
+      : memory_hits(0),
+        disk_hits(0),
+        misses(0),
+        promotions(0) {
+  }
+
+  // The share of lookups that found an entry in either tier.
+  double hit_rate() const {
+    int64 lookups = memory_hits + disk_hits + misses;
+    if (!lookups)
+      return 0;
+    return static_cast<double>(memory_hits + disk_hits) / lookups;
+  }
+
+  // Entries found in the memory tier.
+  int64 memory_hits;
+  // Entries that missed the memory tier (if any) but were found on disk.
+  int64 disk_hits;
+  // Entries found in neither tier.
+  int64 misses;
+  // Disk entries that were copied into the memory tier after being read.
+  int64 promotions;
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,432 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE-CHROMIUM file.
+
+#include "browser/net/http_server_properties_manager.h"
+
+#include "base/bind.h"
+#include "base/prefs/pref_registry_simple.h"
+#include "base/prefs/pref_service.h"
+#include "base/values.h"
+#include "content/public/browser/browser_thread.h"
+#include "net/base/host_port_pair.h"
+
+using content::BrowserThread;
+
+namespace brightray {
+
+namespace {
+
+const char kHttpServerPropertiesPref[] = "net.http_server_properties";
+
+// Bump this when the format of the preference changes. Preferences written
+// with another version are ignored.
+const int kVersionNumber = 1;
+
+const char kVersionKey[] = "version";
+const char kServersKey[] = "servers";
+const char kSupportsSpdyKey[] = "supports_spdy";
+const char kAlternateProtocolKey[] = "alternate_protocol";
+const char kPortKey[] = "port";
+const char kProtocolKey[] = "protocol_str";
+const char kPipelineCapabilityKey[] = "pipeline_capability";
+
+// How long changes are collected before they are written to the preference.
+const int kUpdatePrefsDelaySeconds = 5;
+
+}  // namespace
+
+HttpServerPropertiesManager::HttpServerPropertiesManager(
+    PrefService* pref_service)
+    : pref_service_(pref_service),
+      saved_properties_applied_(false),
+      update_prefs_pending_(false) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  DCHECK(pref_service_);
+
+  ui_weak_ptr_factory_.reset(
+      new base::WeakPtrFactory<HttpServerPropertiesManager>(this));
+  ui_weak_ptr_ = ui_weak_ptr_factory_->GetWeakPtr();
+
+  // Preferences are loaded asynchronously; until then the preference only
+  // has its default value.
+  if (pref_service_->GetInitializationStatus() ==
+      PrefService::INITIALIZATION_STATUS_WAITING) {
+    pref_service_->AddPrefInitObserver(
+        base::Bind(&HttpServerPropertiesManager::OnPrefsInitializedOnUI,
+                   ui_weak_ptr_));
+  } else {
+    ReadPrefsOnUI();
+  }
+}
+
+HttpServerPropertiesManager::~HttpServerPropertiesManager() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  io_weak_ptr_factory_.reset();
+}
+
+// static
+void HttpServerPropertiesManager::RegisterPrefs(PrefRegistrySimple* registry) {
+  registry->RegisterDictionaryPref(kHttpServerPropertiesPref);
+}
+
+void HttpServerPropertiesManager::InitializeOnIOThread() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  io_weak_ptr_factory_.reset(
+      new base::WeakPtrFactory<HttpServerPropertiesManager>(this));
+  http_server_properties_impl_.reset(new net::HttpServerPropertiesImpl);
+  io_prefs_update_timer_.reset(
+      new base::OneShotTimer<HttpServerPropertiesManager>);
+
+  if (pending_snapshot_)
+    ApplySnapshotOnIO(pending_snapshot_.Pass());
+}
+
+void HttpServerPropertiesManager::OnPrefsInitializedOnUI(bool succeeded) {
+  ReadPrefsOnUI();
+}
+
+void HttpServerPropertiesManager::ReadPrefsOnUI() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+
+  scoped_ptr<Snapshot> snapshot(new Snapshot);
+  auto properties = pref_service_->GetDictionary(kHttpServerPropertiesPref);
+  int version;
+  const base::DictionaryValue* servers;
+  if (properties->GetInteger(kVersionKey, &version) &&
+      version == kVersionNumber &&
+      properties->GetDictionaryWithoutPathExpansion(kServersKey, &servers))
+    ReadSnapshot(*servers, snapshot.get());
+
+  // Unretained is safe because we're deleted on the IO thread, after
+  // ShutdownOnUIThread(), so this task runs first.
+  BrowserThread::PostTask(
+      BrowserThread::IO,
+      FROM_HERE,
+      base::Bind(&HttpServerPropertiesManager::ApplySnapshotOnIO,
+                 base::Unretained(this),
+                 base::Passed(&snapshot)));
+}
+
+void HttpServerPropertiesManager::ApplySnapshotOnIO(
+    scoped_ptr<Snapshot> snapshot) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (!http_server_properties_impl_) {
+    pending_snapshot_ = snapshot.Pass();
+    return;
+  }
+
+  // What has been learned since startup is newer than what was saved.
+  base::ListValue spdy_server_list;
+  http_server_properties_impl_->GetSpdyServerList(&spdy_server_list);
+  for (size_t i = 0; i < spdy_server_list.GetSize(); ++i) {
+    std::string server;
+    if (spdy_server_list.GetString(i, &server))
+      snapshot->spdy_servers.push_back(server);
+  }
+  auto& alternate_protocols =
+      http_server_properties_impl_->alternate_protocol_map();
+  for (auto it = alternate_protocols.begin(); it != alternate_protocols.end();
+       ++it)
+    snapshot->alternate_protocols[it->first] = it->second;
+  auto pipeline_capabilities =
+      http_server_properties_impl_->GetPipelineCapabilityMap();
+  for (auto it = pipeline_capabilities.begin();
+       it != pipeline_capabilities.end(); ++it)
+    snapshot->pipeline_capabilities[it->first] = it->second;
+
+  http_server_properties_impl_->InitializeSpdyServers(
+      &snapshot->spdy_servers, true);
+  http_server_properties_impl_->InitializeAlternateProtocolServers(
+      &snapshot->alternate_protocols);
+  http_server_properties_impl_->InitializePipelineCapabilities(
+      &snapshot->pipeline_capabilities);
+
+  saved_properties_applied_ = true;
+  if (update_prefs_pending_)
+    ScheduleUpdatePrefsOnIO();
+}
+
+void HttpServerPropertiesManager::ShutdownOnUIThread() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  // Cancel any pending updates, and stop listening for pref change updates.
+  ui_weak_ptr_factory_.reset();
+  pref_service_ = NULL;
+}
+
+base::WeakPtr<net::HttpServerProperties>
+    HttpServerPropertiesManager::GetWeakPtr() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return io_weak_ptr_factory_->GetWeakPtr();
+}
+
+void HttpServerPropertiesManager::Clear() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->Clear();
+  ScheduleUpdatePrefsOnIO();
+}
+
+bool HttpServerPropertiesManager::SupportsSpdy(
+    const net::HostPortPair& server) const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->SupportsSpdy(server);
+}
+
+void HttpServerPropertiesManager::SetSupportsSpdy(
+    const net::HostPortPair& server,
+    bool support_spdy) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->SetSupportsSpdy(server, support_spdy);
+  ScheduleUpdatePrefsOnIO();
+}
+
+bool HttpServerPropertiesManager::HasAlternateProtocol(
+    const net::HostPortPair& server) const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->HasAlternateProtocol(server);
+}
+
+net::PortAlternateProtocolPair
+HttpServerPropertiesManager::GetAlternateProtocol(
+    const net::HostPortPair& server) const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->GetAlternateProtocol(server);
+}
+
+void HttpServerPropertiesManager::SetAlternateProtocol(
+    const net::HostPortPair& server,
+    uint16 alternate_port,
+    net::AlternateProtocol alternate_protocol) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->SetAlternateProtocol(
+      server, alternate_port, alternate_protocol);
+  ScheduleUpdatePrefsOnIO();
+}
+
+void HttpServerPropertiesManager::SetBrokenAlternateProtocol(
+    const net::HostPortPair& server) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->SetBrokenAlternateProtocol(server);
+  ScheduleUpdatePrefsOnIO();
+}
+
+const net::AlternateProtocolMap&
+HttpServerPropertiesManager::alternate_protocol_map() const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->alternate_protocol_map();
+}
+
+const net::SettingsMap& HttpServerPropertiesManager::GetSpdySettings(
+    const net::HostPortPair& host_port_pair) const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->GetSpdySettings(host_port_pair);
+}
+
+bool HttpServerPropertiesManager::SetSpdySetting(
+    const net::HostPortPair& host_port_pair,
+    net::SpdySettingsIds id,
+    net::SpdySettingsFlags flags,
+    uint32 value) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  // SPDY settings are not persisted; the server sends them again on the
+  // first connection.
+  return http_server_properties_impl_->SetSpdySetting(
+      host_port_pair, id, flags, value);
+}
+
+void HttpServerPropertiesManager::ClearSpdySettings(
+    const net::HostPortPair& host_port_pair) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->ClearSpdySettings(host_port_pair);
+}
+
+void HttpServerPropertiesManager::ClearAllSpdySettings() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->ClearAllSpdySettings();
+}
+
+const net::SpdySettingsMap&
+HttpServerPropertiesManager::spdy_settings_map() const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->spdy_settings_map();
+}
+
+net::HttpPipelinedHostCapability
+HttpServerPropertiesManager::GetPipelineCapability(
+    const net::HostPortPair& origin) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->GetPipelineCapability(origin);
+}
+
+void HttpServerPropertiesManager::SetPipelineCapability(
+    const net::HostPortPair& origin,
+    net::HttpPipelinedHostCapability capability) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->SetPipelineCapability(origin, capability);
+  ScheduleUpdatePrefsOnIO();
+}
+
+void HttpServerPropertiesManager::ClearPipelineCapabilities() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  http_server_properties_impl_->ClearPipelineCapabilities();
+  ScheduleUpdatePrefsOnIO();
+}
+
+net::PipelineCapabilityMap
+HttpServerPropertiesManager::GetPipelineCapabilityMap() const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  return http_server_properties_impl_->GetPipelineCapabilityMap();
+}
+
+// static
+void HttpServerPropertiesManager::ReadSnapshot(
+    const base::DictionaryValue& servers,
+    Snapshot* snapshot) {
+  for (base::DictionaryValue::Iterator it(servers); !it.IsAtEnd();
+       it.Advance()) {
+    auto server = net::HostPortPair::FromString(it.key());
+    const base::DictionaryValue* properties;
+    if (server.host().empty() || !it.value().GetAsDictionary(&properties))
+      continue;
+
+    bool supports_spdy;
+    if (properties->GetBoolean(kSupportsSpdyKey, &supports_spdy) &&
+        supports_spdy)
+      snapshot->spdy_servers.push_back(it.key());
+
+    const base::DictionaryValue* alternate_protocol;
+    int port;
+    std::string protocol_str;
+    if (properties->GetDictionaryWithoutPathExpansion(
+            kAlternateProtocolKey, &alternate_protocol) &&
+        alternate_protocol->GetInteger(kPortKey, &port) &&
+        port > 0 && port <= kuint16max &&
+        alternate_protocol->GetString(kProtocolKey, &protocol_str)) {
+      auto protocol = net::AlternateProtocolFromString(protocol_str);
+      if (protocol != net::UNINITIALIZED_ALTERNATE_PROTOCOL &&
+          protocol != net::ALTERNATE_PROTOCOL_BROKEN) {
+        net::PortAlternateProtocolPair pair;
+        pair.port = port;
+        pair.protocol = protocol;
+        snapshot->alternate_protocols[server] = pair;
+      }
+    }
+
+    int capability;
+    if (properties->GetInteger(kPipelineCapabilityKey, &capability) &&
+        capability > net::PIPELINE_UNKNOWN &&
+        capability <= net::PIPELINE_PROBABLY_CAPABLE) {
+      snapshot->pipeline_capabilities[server] =
+          static_cast<net::HttpPipelinedHostCapability>(capability);
+    }
+  }
+}
+
+// static
+void HttpServerPropertiesManager::WriteSnapshot(
+    const Snapshot& snapshot,
+    base::DictionaryValue* servers) {
+  // Keys are "host:port", so don't let the dots in the host be treated as
+  // paths.
+  for (auto it = snapshot.spdy_servers.begin();
+       it != snapshot.spdy_servers.end(); ++it) {
+    auto properties = new base::DictionaryValue;
+    properties->SetBoolean(kSupportsSpdyKey, true);
+    servers->SetWithoutPathExpansion(*it, properties);
+  }
+
+  for (auto it = snapshot.alternate_protocols.begin();
+       it != snapshot.alternate_protocols.end(); ++it) {
+    // A broken protocol is only remembered for this session.
+    if (it->second.protocol == net::ALTERNATE_PROTOCOL_BROKEN)
+      continue;
+
+    auto key = it->first.ToString();
+    base::DictionaryValue* properties;
+    if (!servers->GetDictionaryWithoutPathExpansion(key, &properties)) {
+      properties = new base::DictionaryValue;
+      servers->SetWithoutPathExpansion(key, properties);
+    }
+    auto alternate_protocol = new base::DictionaryValue;
+    alternate_protocol->SetInteger(kPortKey, it->second.port);
+    alternate_protocol->SetString(
+        kProtocolKey, net::AlternateProtocolToString(it->second.protocol));
+    properties->SetWithoutPathExpansion(kAlternateProtocolKey,
+                                        alternate_protocol);
+  }
+
+  for (auto it = snapshot.pipeline_capabilities.begin();
+       it != snapshot.pipeline_capabilities.end(); ++it) {
+    if (it->second == net::PIPELINE_UNKNOWN)
+      continue;
+
+    auto key = it->first.ToString();
+    base::DictionaryValue* properties;
+    if (!servers->GetDictionaryWithoutPathExpansion(key, &properties)) {
+      properties = new base::DictionaryValue;
+      servers->SetWithoutPathExpansion(key, properties);
+    }
+    properties->SetInteger(kPipelineCapabilityKey, it->second);
+  }
+}
+
+void HttpServerPropertiesManager::ScheduleUpdatePrefsOnIO() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  // Writing now would replace the saved properties with only the ones
+  // learned since startup.
+  if (!saved_properties_applied_) {
+    update_prefs_pending_ = true;
+    return;
+  }
+
+  // Changes that arrive while an update is pending are picked up by it.
+  if (io_prefs_update_timer_->IsRunning())
+    return;
+
+  io_prefs_update_timer_->Start(
+      FROM_HERE,
+      base::TimeDelta::FromSeconds(kUpdatePrefsDelaySeconds),
+      this,
+      &HttpServerPropertiesManager::UpdatePrefsFromCacheOnIO);
+}
+
+void HttpServerPropertiesManager::UpdatePrefsFromCacheOnIO() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  scoped_ptr<Snapshot> snapshot(new Snapshot);
+
+  base::ListValue spdy_server_list;
+  http_server_properties_impl_->GetSpdyServerList(&spdy_server_list);
+  for (size_t i = 0; i < spdy_server_list.GetSize(); ++i) {
+    std::string server;
+    if (spdy_server_list.GetString(i, &server))
+      snapshot->spdy_servers.push_back(server);
+  }
+  snapshot->alternate_protocols =
+      http_server_properties_impl_->alternate_protocol_map();
+  snapshot->pipeline_capabilities =
+      http_server_properties_impl_->GetPipelineCapabilityMap();
+
+  BrowserThread::PostTask(
+      BrowserThread::UI,
+      FROM_HERE,
+      base::Bind(&HttpServerPropertiesManager::UpdatePrefsOnUI,
+                 ui_weak_ptr_,
+                 base::Passed(&snapshot)));
+}
+
+void HttpServerPropertiesManager::UpdatePrefsOnUI(
+    scoped_ptr<Snapshot> snapshot) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+
+  scoped_ptr<base::DictionaryValue> servers(new base::DictionaryValue);
+  WriteSnapshot(*snapshot, servers.get());
+
+  base::DictionaryValue properties;
+  properties.SetInteger(kVersionKey, kVersionNumber);
+  properties.SetWithoutPathExpansion(kServersKey, servers.release());
+  pref_service_->Set(kHttpServerPropertiesPref, properties);
+}
+
+}  // namespace brightray
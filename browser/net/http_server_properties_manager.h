@@ -0,0 +1,138 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE-CHROMIUM file.
+
+#ifndef BRIGHTRAY_BROWSER_NET_HTTP_SERVER_PROPERTIES_MANAGER_H_
+#define BRIGHTRAY_BROWSER_NET_HTTP_SERVER_PROPERTIES_MANAGER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
+#include "net/http/http_server_properties.h"
+#include "net/http/http_server_properties_impl.h"
+
+class PrefRegistrySimple;
+class PrefService;
+
+namespace base {
+class DictionaryValue;
+class ListValue;
+}
+
+namespace brightray {
+
+// Remembers which servers support SPDY, their alternate protocols and their
+// HTTP pipelining capability across restarts by keeping them in a
+// dictionary preference.
+//
+// Constructed on the UI thread, where the preference is read once the
+// PrefService has finished loading it from disk. The saved properties are
+// then handed to the IO thread and merged with whatever has been learned in
+// the meantime. All net::HttpServerProperties methods must be called on the
+// IO thread, after InitializeOnIOThread(). Changes are collected for a few
+// seconds before being written back to the preference on the UI thread, but
+// never before the saved properties have been read, so that they aren't
+// overwritten.
+class HttpServerPropertiesManager : public net::HttpServerProperties {
+ public:
+  // |pref_service| must outlive the call to ShutdownOnUIThread().
+  explicit HttpServerPropertiesManager(PrefService* pref_service);
+  virtual ~HttpServerPropertiesManager();
+
+  static void RegisterPrefs(PrefRegistrySimple* registry);
+
+  // Must be called on the IO thread before any other method. The saved
+  // properties are applied now if they have been read already, and as soon
+  // as they are otherwise.
+  void InitializeOnIOThread();
+
+  // Stops writing to |pref_service|. Must be called on the UI thread before
+  // the PrefService is destroyed.
+  void ShutdownOnUIThread();
+
+  // net::HttpServerProperties:
+  virtual base::WeakPtr<net::HttpServerProperties> GetWeakPtr() OVERRIDE;
+  virtual void Clear() OVERRIDE;
+  virtual bool SupportsSpdy(const net::HostPortPair& server) const OVERRIDE;
+  virtual void SetSupportsSpdy(const net::HostPortPair& server,
+                               bool support_spdy) OVERRIDE;
+  virtual bool HasAlternateProtocol(
+      const net::HostPortPair& server) const OVERRIDE;
+  virtual net::PortAlternateProtocolPair GetAlternateProtocol(
+      const net::HostPortPair& server) const OVERRIDE;
+  virtual void SetAlternateProtocol(
+      const net::HostPortPair& server,
+      uint16 alternate_port,
+      net::AlternateProtocol alternate_protocol) OVERRIDE;
+  virtual void SetBrokenAlternateProtocol(
+      const net::HostPortPair& server) OVERRIDE;
+  virtual const net::AlternateProtocolMap&
+      alternate_protocol_map() const OVERRIDE;
+  virtual const net::SettingsMap& GetSpdySettings(
+      const net::HostPortPair& host_port_pair) const OVERRIDE;
+  virtual bool SetSpdySetting(const net::HostPortPair& host_port_pair,
+                              net::SpdySettingsIds id,
+                              net::SpdySettingsFlags flags,
+                              uint32 value) OVERRIDE;
+  virtual void ClearSpdySettings(
+      const net::HostPortPair& host_port_pair) OVERRIDE;
+  virtual void ClearAllSpdySettings() OVERRIDE;
+  virtual const net::SpdySettingsMap& spdy_settings_map() const OVERRIDE;
+  virtual net::HttpPipelinedHostCapability GetPipelineCapability(
+      const net::HostPortPair& origin) OVERRIDE;
+  virtual void SetPipelineCapability(
+      const net::HostPortPair& origin,
+      net::HttpPipelinedHostCapability capability) OVERRIDE;
+  virtual void ClearPipelineCapabilities() OVERRIDE;
+  virtual net::PipelineCapabilityMap GetPipelineCapabilityMap() const OVERRIDE;
+
+ private:
+  // A copy of the persisted properties that can be handed between threads.
+  struct Snapshot {
+    std::vector<std::string> spdy_servers;
+    net::AlternateProtocolMap alternate_protocols;
+    net::PipelineCapabilityMap pipeline_capabilities;
+  };
+
+  static void ReadSnapshot(const base::DictionaryValue& servers,
+                           Snapshot* snapshot);
+  static void WriteSnapshot(const Snapshot& snapshot,
+                            base::DictionaryValue* servers);
+
+  void OnPrefsInitializedOnUI(bool succeeded);
+  void ReadPrefsOnUI();
+  void ApplySnapshotOnIO(scoped_ptr<Snapshot> snapshot);
+
+  // Starts the timer that writes the properties back to the preference, if
+  // it isn't already running and the saved properties have been applied.
+  void ScheduleUpdatePrefsOnIO();
+  void UpdatePrefsFromCacheOnIO();
+  void UpdatePrefsOnUI(scoped_ptr<Snapshot> snapshot);
+
+  // Only used on the UI thread.
+  PrefService* pref_service_;
+  scoped_ptr<base::WeakPtrFactory<HttpServerPropertiesManager> >
+      ui_weak_ptr_factory_;
+  base::WeakPtr<HttpServerPropertiesManager> ui_weak_ptr_;
+
+  // Only used on the IO thread.
+  scoped_ptr<net::HttpServerPropertiesImpl> http_server_properties_impl_;
+  // The saved properties, if they arrive before InitializeOnIOThread().
+  scoped_ptr<Snapshot> pending_snapshot_;
+  bool saved_properties_applied_;
+  // Set when a change came in before the saved properties were applied.
+  bool update_prefs_pending_;
+  scoped_ptr<base::OneShotTimer<HttpServerPropertiesManager> >
+      io_prefs_update_timer_;
+  scoped_ptr<base::WeakPtrFactory<HttpServerPropertiesManager> >
+      io_weak_ptr_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpServerPropertiesManager);
+};
+
+}  // namespace brightray
+
+#endif
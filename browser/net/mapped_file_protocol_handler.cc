@@ -0,0 +1,363 @@
+#include "browser/net/mapped_file_protocol_handler.h"
+
+#include <algorithm>
+
+#include "browser/net/url_request_mapped_job.h"
+
+#include "base/bind.h"
+#include "base/containers/mru_cache.h"
+#include "base/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/memory/weak_ptr.h"
+#include "base/platform_file.h"
+#include "base/synchronization/lock.h"
+#include "base/task_runner.h"
+#include "net/base/mime_util.h"
+#include "net/base/net_errors.h"
+#include "net/base/net_util.h"
+#include "net/base/network_delegate.h"
+#include "net/url_request/file_protocol_handler.h"
+#include "net/url_request/url_request.h"
+#include "net/url_request/url_request_error_job.h"
+
+#if defined(OS_POSIX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace brightray {
+
+namespace {
+
+// How many mappings MappedFileCache keeps around.
+const size_t kMaxCachedMappings = 8;
+
+// How many files that can't be mapped MappedFileCache remembers.
+const size_t kMaxUnmappablePaths = 64;
+
+// How far ahead of the current read position the OS is asked to page in.
+const size_t kReadaheadBytes = 4 * 1024 * 1024;
+
+// A mapped file and the file info it was mapped with, so a stale mapping can
+// be told apart from a current one.
+class MappedFile : public base::RefCountedThreadSafe<MappedFile> {
+ public:
+  MappedFile(const base::FilePath& path, const base::PlatformFileInfo& info)
+      : path_(path),
+        info_(info) {
+  }
+
+  // Maps the file. This blocks.
+  bool Initialize() {
+    // Empty files can't be mapped, and don't need to be.
+    if (info_.size == 0)
+      return true;
+    if (!file_.Initialize(path_) ||
+        file_.length() != static_cast<size_t>(info_.size))
+      return false;
+#if defined(OS_POSIX)
+    madvise(const_cast<uint8*>(file_.data()), file_.length(),
+            MADV_SEQUENTIAL);
+#endif
+    return true;
+  }
+
+  bool IsCurrent(const base::PlatformFileInfo& info) const {
+    return info.size == info_.size &&
+        info.last_modified == info_.last_modified;
+  }
+
+  base::StringPiece data() const {
+    if (!file_.IsValid())
+      return base::StringPiece();
+    return base::StringPiece(reinterpret_cast<const char*>(file_.data()),
+                             file_.length());
+  }
+
+  // Asks the OS to start paging in [begin, end) without waiting for it.
+  void WillNeed(size_t begin, size_t end) const {
+#if defined(OS_POSIX)
+    if (!file_.IsValid() || begin >= end)
+      return;
+    static const size_t page_size = getpagesize();
+    size_t aligned_begin = begin - begin % page_size;
+    madvise(const_cast<uint8*>(file_.data()) + aligned_begin,
+            end - aligned_begin,
+            MADV_WILLNEED);
+#endif
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<MappedFile>;
+
+  ~MappedFile() {}
+
+  base::FilePath path_;
+  base::PlatformFileInfo info_;
+  base::MemoryMappedFile file_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace
+
+// The most recently used mappings, shared by all jobs of a handler, and
+// what may be mapped in the first place.
+class MappedFileCache : public base::RefCountedThreadSafe<MappedFileCache> {
+ public:
+  explicit MappedFileCache(const std::vector<base::FilePath>& mapped_dirs)
+      : mapped_dirs_(mapped_dirs),
+        cache_(kMaxCachedMappings),
+        unmappable_paths_(kMaxUnmappablePaths) {
+  }
+
+  // Only looks at the path, so it can be called on any thread.
+  bool IsInMappedDirectory(const base::FilePath& path) const {
+    for (auto it = mapped_dirs_.begin(); it != mapped_dirs_.end(); ++it) {
+      if (it->IsParent(path))
+        return true;
+    }
+    return false;
+  }
+
+  // Files found not to be safe to map are left to net::FileProtocolHandler
+  // from then on.
+  void MarkUnmappable(const base::FilePath& path) {
+    base::AutoLock locker(lock_);
+    unmappable_paths_.Put(path, true);
+  }
+
+  bool IsUnmappable(const base::FilePath& path) const {
+    base::AutoLock locker(lock_);
+    return unmappable_paths_.Peek(path) != unmappable_paths_.end();
+  }
+
+  // Returns a mapping of |path| that matches |info|, reusing a cached one if
+  // the file hasn't changed since. This blocks.
+  scoped_refptr<MappedFile> Get(const base::FilePath& path,
+                                const base::PlatformFileInfo& info) {
+    {
+      base::AutoLock locker(lock_);
+      auto it = cache_.Get(path);
+      if (it != cache_.end() && it->second->IsCurrent(info))
+        return it->second;
+    }
+
+    // Map outside the lock so other files can be served meanwhile.
+    scoped_refptr<MappedFile> file(new MappedFile(path, info));
+    if (!file->Initialize())
+      return NULL;
+
+    base::AutoLock locker(lock_);
+    cache_.Put(path, file);
+    return file;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<MappedFileCache>;
+
+  ~MappedFileCache() {}
+
+  const std::vector<base::FilePath> mapped_dirs_;
+
+  mutable base::Lock lock_;
+  base::MRUCache<base::FilePath, scoped_refptr<MappedFile> > cache_;
+  base::MRUCache<base::FilePath, bool> unmappable_paths_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFileCache);
+};
+
+namespace {
+
+struct OpenResult {
+  OpenResult() : error(net::OK), is_directory(false), unmappable(false) {}
+
+  int error;
+  bool is_directory;
+  // Set if the request should be restarted and served without mapping.
+  bool unmappable;
+  scoped_refptr<MappedFile> file;
+  std::string mime_type;
+};
+
+// Whether |path| can be mapped without another process being able to
+// truncate it under us. This blocks.
+bool IsSafeToMap(const MappedFileCache& cache, const base::FilePath& path) {
+  // Symbolic links could lead out of the mapped directories.
+  base::FilePath real_path;
+  if (!base::NormalizeFilePath(path, &real_path) ||
+      !cache.IsInMappedDirectory(real_path))
+    return false;
+#if defined(OS_POSIX)
+  struct stat info;
+  if (stat(real_path.value().c_str(), &info) != 0)
+    return false;
+  return S_ISREG(info.st_mode) && info.st_uid == geteuid();
+#else
+  return true;
+#endif
+}
+
+void OpenOnFileThread(scoped_refptr<MappedFileCache> cache,
+                      const base::FilePath& path,
+                      OpenResult* result) {
+  base::PlatformFileInfo info;
+  if (!base::GetFileInfo(path, &info)) {
+    result->error = net::ERR_FILE_NOT_FOUND;
+    return;
+  }
+  if (info.is_directory) {
+    result->is_directory = true;
+    return;
+  }
+  if (!IsSafeToMap(*cache, path)) {
+    cache->MarkUnmappable(path);
+    result->unmappable = true;
+    return;
+  }
+
+  result->file = cache->Get(path, info);
+  if (!result->file) {
+    result->error = net::ERR_FAILED;
+    return;
+  }
+  net::GetMimeTypeFromFile(path, &result->mime_type);
+}
+
+class URLRequestMappedFileJob : public URLRequestMappedJob {
+ public:
+  URLRequestMappedFileJob(net::URLRequest* request,
+                          net::NetworkDelegate* network_delegate,
+                          const base::FilePath& path,
+                          base::TaskRunner* file_task_runner,
+                          MappedFileCache* cache)
+      : URLRequestMappedJob(request, network_delegate, file_task_runner),
+        path_(path),
+        file_task_runner_(file_task_runner),
+        cache_(cache),
+        is_directory_(false),
+        hinted_begin_(0),
+        hinted_end_(0),
+        weak_factory_(this) {
+  }
+
+  virtual void Start() OVERRIDE {
+    auto result = new OpenResult;
+    file_task_runner_->PostTaskAndReply(
+        FROM_HERE,
+        base::Bind(&OpenOnFileThread, cache_, path_, result),
+        base::Bind(&URLRequestMappedFileJob::DidOpen,
+                   weak_factory_.GetWeakPtr(),
+                   base::Owned(result)));
+  }
+
+  virtual void Kill() OVERRIDE {
+    weak_factory_.InvalidateWeakPtrs();
+    URLRequestMappedJob::Kill();
+  }
+
+  // Like URLRequestFileJob, send directories without a trailing slash to
+  // the URL with one, which net::FileProtocolHandler lists.
+  virtual bool IsRedirectResponse(GURL* location,
+                                  int* http_status_code) OVERRIDE {
+    if (!is_directory_)
+      return false;
+
+    std::string new_path = request()->url().path();
+    new_path.push_back('/');
+    GURL::Replacements replacements;
+    replacements.SetPathStr(new_path);
+    *location = request()->url().ReplaceComponents(replacements);
+    *http_status_code = 301;
+    return true;
+  }
+
+ protected:
+  virtual void WillReadRange(size_t begin, size_t end) OVERRIDE {
+    // Ask for the next window once half of the current one has been read,
+    // or when a new range starts somewhere else.
+    if (begin >= hinted_begin_ && end + kReadaheadBytes / 2 <= hinted_end_)
+      return;
+    hinted_begin_ = begin;
+    hinted_end_ = std::min(begin + kReadaheadBytes, file_->data().size());
+    file_->WillNeed(hinted_begin_, hinted_end_);
+  }
+
+ private:
+  virtual ~URLRequestMappedFileJob() {}
+
+  void DidOpen(OpenResult* result) {
+    // The next job for this request comes from net::FileProtocolHandler.
+    if (result->unmappable) {
+      NotifyRestartRequired();
+      return;
+    }
+    if (result->is_directory) {
+      is_directory_ = true;
+      NotifyHeadersComplete();
+      return;
+    }
+    if (result->error != net::OK) {
+      OnDataFailed(result->error);
+      return;
+    }
+
+    file_ = result->file;
+    OnDataReady(file_->data(), file_, result->mime_type, false);
+  }
+
+  base::FilePath path_;
+  scoped_refptr<base::TaskRunner> file_task_runner_;
+  scoped_refptr<MappedFileCache> cache_;
+
+  scoped_refptr<MappedFile> file_;
+  bool is_directory_;
+
+  // The part of the file the OS was last told would be needed.
+  size_t hinted_begin_;
+  size_t hinted_end_;
+
+  base::WeakPtrFactory<URLRequestMappedFileJob> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLRequestMappedFileJob);
+};
+
+}  // namespace
+
+MappedFileProtocolHandler::MappedFileProtocolHandler(
+    const scoped_refptr<base::TaskRunner>& file_task_runner,
+    const std::vector<base::FilePath>& mapped_directories)
+    : file_task_runner_(file_task_runner),
+      cache_(new MappedFileCache(mapped_directories)),
+      file_handler_(new net::FileProtocolHandler(file_task_runner)) {
+}
+
+MappedFileProtocolHandler::~MappedFileProtocolHandler() {
+}
+
+net::URLRequestJob* MappedFileProtocolHandler::MaybeCreateJob(
+    net::URLRequest* request,
+    net::NetworkDelegate* network_delegate) const {
+  base::FilePath file_path;
+  const bool is_file = net::FileURLToFilePath(request->url(), &file_path);
+
+  // Like net::FileProtocolHandler, decide between files and directories by
+  // looking at the path instead of touching the file system.
+  if (!is_file || file_path.EndsWithSeparator() ||
+      file_path.value().empty() ||
+      !cache_->IsInMappedDirectory(file_path) ||
+      cache_->IsUnmappable(file_path))
+    return file_handler_->MaybeCreateJob(request, network_delegate);
+
+  if (!network_delegate ||
+      !network_delegate->CanAccessFile(*request, file_path)) {
+    return new net::URLRequestErrorJob(request, network_delegate,
+                                       net::ERR_ACCESS_DENIED);
+  }
+
+  return new URLRequestMappedFileJob(request, network_delegate, file_path,
+                                     file_task_runner_.get(), cache_.get());
+}
+
+}  // namespace brightray
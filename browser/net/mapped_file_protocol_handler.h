@@ -0,0 +1,70 @@
+#ifndef BRIGHTRAY_BROWSER_NET_MAPPED_FILE_PROTOCOL_HANDLER_H_
+#define BRIGHTRAY_BROWSER_NET_MAPPED_FILE_PROTOCOL_HANDLER_H_
+
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "net/url_request/url_request_job_factory.h"
+
+namespace base {
+class TaskRunner;
+}
+
+namespace net {
+class FileProtocolHandler;
+}
+
+namespace brightray {
+
+class MappedFileCache;
+
+// A file:// handler for large files. Instead of reading a file through a
+// buffer on the blocking pool for every chunk, like net::FileProtocolHandler
+// does, it maps the file once and serves reads and byte ranges by copying
+// from the mapping on the blocking pool, telling the OS which pages will be
+// needed next. Mappings of recently used files are kept around, so a page
+// streaming a large file with many range requests only maps it once.
+//
+// If a mapped file is truncated by someone else, touching the missing pages
+// raises SIGBUS and takes down the browser. So only files under
+// |mapped_directories|, which the embedder must trust not to be truncated
+// behind its back, are mapped, and only if they are regular files owned by
+// the user the browser runs as. Everything else, including directory
+// listings, is left to net::FileProtocolHandler. To use it, install it for
+// the file scheme from BrowserClient::CreateRequestContext():
+//
+//   (*protocol_handlers)[chrome::kFileScheme] =
+//       linked_ptr<ProtocolHandler>(new MappedFileProtocolHandler(
+//           content::BrowserThread::GetBlockingPool()->
+//               GetTaskRunnerWithShutdownBehavior(
+//                   base::SequencedWorkerPool::SKIP_ON_SHUTDOWN),
+//           media_directories));
+class MappedFileProtocolHandler
+    : public net::URLRequestJobFactory::ProtocolHandler {
+ public:
+  // Files are opened and mapped on |file_task_runner|. |mapped_directories|
+  // should be given without symbolic links.
+  MappedFileProtocolHandler(
+      const scoped_refptr<base::TaskRunner>& file_task_runner,
+      const std::vector<base::FilePath>& mapped_directories);
+  virtual ~MappedFileProtocolHandler();
+
+  // net::URLRequestJobFactory::ProtocolHandler:
+  virtual net::URLRequestJob* MaybeCreateJob(
+      net::URLRequest* request,
+      net::NetworkDelegate* network_delegate) const OVERRIDE;
+
+ private:
+  scoped_refptr<base::TaskRunner> file_task_runner_;
+  scoped_refptr<MappedFileCache> cache_;
+  // Serves everything that isn't mapped.
+  scoped_ptr<net::FileProtocolHandler> file_handler_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFileProtocolHandler);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,207 @@
+#include "browser/net/network_stats.h"
+
+#include <algorithm>
+
+#include "content/public/browser/resource_request_info.h"
+#include "net/url_request/url_request.h"
+
+namespace brightray {
+
+namespace {
+
+// Once this many origins or render views have been seen, new ones are
+// lumped together under an empty origin or (-1, -1), so a long-running
+// process doesn't grow the maps without bound.
+const size_t kMaxGroups = 1000;
+
+const RenderViewKey kNoRenderView(-1, -1);
+
+template <typename Key>
+NetworkGroupStats& GetGroup(std::map<Key, NetworkGroupStats>* groups,
+                            const Key& key,
+                            const Key& overflow_key) {
+  auto it = groups->find(key);
+  if (it != groups->end())
+    return it->second;
+  if (groups->size() >= kMaxGroups)
+    return (*groups)[overflow_key];
+  return (*groups)[key];
+}
+
+void AddToGroup(NetworkGroupStats* group,
+                bool failed,
+                int64 raw_bytes_read,
+                base::TimeDelta queue_time,
+                base::TimeDelta time_to_headers,
+                base::TimeDelta total_time,
+                base::TimeDelta cache_stalled,
+                base::TimeDelta network_stalled) {
+  ++group->requests;
+  if (failed)
+    ++group->failed_requests;
+  group->raw_bytes_read += raw_bytes_read;
+  if (queue_time > base::TimeDelta())
+    group->queue_time.Add(queue_time);
+  if (time_to_headers > base::TimeDelta())
+    group->time_to_headers.Add(time_to_headers);
+  group->total_time.Add(total_time);
+  if (cache_stalled > base::TimeDelta())
+    group->cache_stalls.Add(cache_stalled);
+  if (network_stalled > base::TimeDelta())
+    group->network_stalls.Add(network_stalled);
+}
+
+}  // namespace
+
+NetworkTimingHistogram::NetworkTimingHistogram() : count(0), sum_ms(0) {
+  for (int i = 0; i < kBucketCount; ++i)
+    buckets[i] = 0;
+}
+
+void NetworkTimingHistogram::Add(base::TimeDelta duration) {
+  int64 ms = std::max<int64>(duration.InMilliseconds(), 0);
+  int bucket = 0;
+  while (ms > 0 && bucket < kBucketCount - 1) {
+    ms >>= 1;
+    ++bucket;
+  }
+  ++buckets[bucket];
+  ++count;
+  sum_ms += duration.InMilliseconds();
+}
+
+NetworkGroupStats::NetworkGroupStats()
+    : requests(0),
+      failed_requests(0),
+      raw_bytes_read(0) {
+}
+
+NetworkStats::NetworkStats() {
+}
+
+NetworkStats::~NetworkStats() {
+}
+
+NetworkStatsRecorder::InFlightRequest::InFlightRequest()
+    : raw_bytes_read(0) {
+}
+
+NetworkStatsRecorder::NetworkStatsRecorder() {
+}
+
+NetworkStatsRecorder::~NetworkStatsRecorder() {
+}
+
+void NetworkStatsRecorder::OnRequestStarted(net::URLRequest* request) {
+  // Redirects go through OnBeforeURLRequest again; keep the original start.
+  auto& info = in_flight_[request];
+  if (info.start.is_null())
+    info.start = base::TimeTicks::Now();
+}
+
+void NetworkStatsRecorder::OnRequestScheduled(
+    const net::URLRequest& request) {
+  // Redirects are scheduled again; only the first wait counts.
+  auto it = in_flight_.find(&request);
+  if (it != in_flight_.end() && it->second.scheduled.is_null())
+    it->second.scheduled = base::TimeTicks::Now();
+}
+
+void NetworkStatsRecorder::OnWaitStateChange(
+    const net::URLRequest& request,
+    net::NetworkDelegate::RequestWaitState state) {
+  auto it = in_flight_.find(&request);
+  if (it == in_flight_.end())
+    return;
+
+  auto& info = it->second;
+  auto now = base::TimeTicks::Now();
+  switch (state) {
+    case net::NetworkDelegate::REQUEST_WAIT_STATE_CACHE_START:
+      info.cache_wait_start = now;
+      break;
+    case net::NetworkDelegate::REQUEST_WAIT_STATE_CACHE_FINISH:
+      if (!info.cache_wait_start.is_null())
+        info.cache_stalled += now - info.cache_wait_start;
+      info.cache_wait_start = base::TimeTicks();
+      break;
+    case net::NetworkDelegate::REQUEST_WAIT_STATE_NETWORK_START:
+      info.network_wait_start = now;
+      break;
+    case net::NetworkDelegate::REQUEST_WAIT_STATE_NETWORK_FINISH:
+      if (!info.network_wait_start.is_null())
+        info.network_stalled += now - info.network_wait_start;
+      info.network_wait_start = base::TimeTicks();
+      break;
+    case net::NetworkDelegate::REQUEST_WAIT_STATE_RESET:
+      info.cache_wait_start = base::TimeTicks();
+      info.network_wait_start = base::TimeTicks();
+      break;
+  }
+}
+
+void NetworkStatsRecorder::OnResponseStarted(net::URLRequest* request) {
+  auto it = in_flight_.find(request);
+  if (it != in_flight_.end() && it->second.headers_received.is_null())
+    it->second.headers_received = base::TimeTicks::Now();
+}
+
+void NetworkStatsRecorder::OnRawBytesRead(const net::URLRequest& request,
+                                          int bytes_read) {
+  auto it = in_flight_.find(&request);
+  if (it != in_flight_.end())
+    it->second.raw_bytes_read += bytes_read;
+}
+
+void NetworkStatsRecorder::OnCompleted(net::URLRequest* request) {
+  auto it = in_flight_.find(request);
+  if (it == in_flight_.end())
+    return;
+
+  Record(*request, it->second);
+  in_flight_.erase(it);
+}
+
+void NetworkStatsRecorder::OnRequestDestroyed(net::URLRequest* request) {
+  in_flight_.erase(request);
+}
+
+void NetworkStatsRecorder::Record(const net::URLRequest& request,
+                                  const InFlightRequest& info) {
+  auto now = base::TimeTicks::Now();
+  base::TimeDelta queue_time;
+  if (!info.scheduled.is_null())
+    queue_time = info.scheduled - info.start;
+  base::TimeDelta time_to_headers;
+  if (!info.headers_received.is_null())
+    time_to_headers = info.headers_received - info.start;
+  auto total_time = now - info.start;
+
+  // A wait that never finished was a stall right up to the end.
+  auto cache_stalled = info.cache_stalled;
+  if (!info.cache_wait_start.is_null())
+    cache_stalled += now - info.cache_wait_start;
+  auto network_stalled = info.network_stalled;
+  if (!info.network_wait_start.is_null())
+    network_stalled += now - info.network_wait_start;
+
+  bool failed = !request.status().is_success();
+
+  AddToGroup(&GetGroup(&stats_.origins,
+                       request.url().GetOrigin().spec(),
+                       std::string()),
+             failed, info.raw_bytes_read, queue_time, time_to_headers,
+             total_time, cache_stalled, network_stalled);
+
+  RenderViewKey render_view = kNoRenderView;
+  auto request_info = content::ResourceRequestInfo::ForRequest(&request);
+  if (request_info) {
+    request_info->GetAssociatedRenderView(&render_view.first,
+                                          &render_view.second);
+  }
+  AddToGroup(&GetGroup(&stats_.render_views, render_view, kNoRenderView),
+             failed, info.raw_bytes_read, queue_time, time_to_headers,
+             total_time, cache_stalled, network_stalled);
+}
+
+}  // namespace brightray
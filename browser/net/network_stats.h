@@ -0,0 +1,116 @@
+#ifndef BRIGHTRAY_BROWSER_NET_NETWORK_STATS_H_
+#define BRIGHTRAY_BROWSER_NET_NETWORK_STATS_H_
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "net/base/network_delegate.h"
+
+namespace net {
+class URLRequest;
+}
+
+namespace brightray {
+
+// Counts durations in power-of-two millisecond buckets: bucket 0 holds
+// durations under 1ms, bucket i holds [2^(i-1), 2^i) ms, and the last bucket
+// holds everything longer.
+struct NetworkTimingHistogram {
+  enum { kBucketCount = 18 };
+
+  NetworkTimingHistogram();
+
+  void Add(base::TimeDelta duration);
+
+  int64 count;
+  int64 sum_ms;
+  int64 buckets[kBucketCount];
+};
+
+// Timings and byte counts for a group of requests, e.g. all the requests to
+// one origin.
+struct NetworkGroupStats {
+  NetworkGroupStats();
+
+  int64 requests;
+  // Requests that completed with an error, including cancelled ones.
+  int64 failed_requests;
+  int64 raw_bytes_read;
+
+  // From the start of the request until it was allowed to go ahead, which
+  // includes any time spent waiting in the RequestScheduler's queue.
+  NetworkTimingHistogram queue_time;
+  // From the start of the request until the response headers arrived.
+  NetworkTimingHistogram time_to_headers;
+  // From the start of the request until it completed.
+  NetworkTimingHistogram total_time;
+  // Time spent blocked on the HTTP cache and on the network (e.g. waiting
+  // for a socket), as reported through OnRequestWaitStateChange().
+  NetworkTimingHistogram cache_stalls;
+  NetworkTimingHistogram network_stalls;
+};
+
+// A render view is identified by its render process and routing IDs; see
+// content::RenderViewHost::FromID(). Requests that don't belong to a render
+// view are recorded under (-1, -1).
+typedef std::pair<int, int> RenderViewKey;
+
+struct NetworkStats {
+  NetworkStats();
+  ~NetworkStats();
+
+  // Keyed by the origin of the request's URL.
+  std::map<std::string, NetworkGroupStats> origins;
+  std::map<RenderViewKey, NetworkGroupStats> render_views;
+};
+
+// Follows requests through the NetworkDelegate hooks and aggregates what it
+// sees. Lives on the IO thread, like the requests themselves, so it needs no
+// locking; embedders get a copy of the totals through BrowserContext.
+class NetworkStatsRecorder {
+ public:
+  NetworkStatsRecorder();
+  ~NetworkStatsRecorder();
+
+  void OnRequestStarted(net::URLRequest* request);
+  // Called once the request scheduler has let |request| start.
+  void OnRequestScheduled(const net::URLRequest& request);
+  void OnWaitStateChange(const net::URLRequest& request,
+                         net::NetworkDelegate::RequestWaitState state);
+  void OnResponseStarted(net::URLRequest* request);
+  void OnRawBytesRead(const net::URLRequest& request, int bytes_read);
+  void OnCompleted(net::URLRequest* request);
+  void OnRequestDestroyed(net::URLRequest* request);
+
+  const NetworkStats& stats() const { return stats_; }
+
+ private:
+  struct InFlightRequest {
+    InFlightRequest();
+
+    base::TimeTicks start;
+    base::TimeTicks scheduled;
+    base::TimeTicks headers_received;
+    base::TimeTicks cache_wait_start;
+    base::TimeTicks network_wait_start;
+    base::TimeDelta cache_stalled;
+    base::TimeDelta network_stalled;
+    int64 raw_bytes_read;
+  };
+
+  typedef std::map<const net::URLRequest*, InFlightRequest> InFlightMap;
+
+  void Record(const net::URLRequest& request, const InFlightRequest& info);
+
+  InFlightMap in_flight_;
+  NetworkStats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetworkStatsRecorder);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,152 @@
+#include "browser/net/request_scheduler.h"
+
+#include <algorithm>
+
+#include "net/base/net_errors.h"
+#include "net/url_request/url_request.h"
+
+namespace brightray {
+
+RequestSchedulerStats::RequestSchedulerStats() : max_queue_depth(0) {
+  for (int i = 0; i < REQUEST_CLASS_COUNT; ++i) {
+    requests[i] = 0;
+    deferred_requests[i] = 0;
+    queue_depth[i] = 0;
+  }
+}
+
+RequestScheduler::RequestScheduler() : running_non_interactive_(0) {
+}
+
+RequestScheduler::~RequestScheduler() {
+}
+
+void RequestScheduler::SetConfig(const RequestSchedulerConfig& config) {
+  config_ = config;
+  // The limits may have been raised or lifted.
+  StartQueuedRequests();
+}
+
+int RequestScheduler::ScheduleRequest(net::URLRequest* request,
+                                      RequestClass request_class,
+                                      const net::CompletionCallback& callback) {
+  DCHECK_LT(request_class, REQUEST_CLASS_COUNT);
+
+  // Redirects come through here again; the request keeps the slot it has.
+  if (running_.count(request))
+    return net::OK;
+  DCHECK(!queued_.count(request));
+
+  ++stats_.requests[request_class];
+  auto origin = request->url().GetOrigin().spec();
+  if (CanStart(request_class, origin)) {
+    Start(request, request_class, origin);
+    return net::OK;
+  }
+
+  QueuedRequest queued;
+  queued.request = request;
+  queued.origin = origin;
+  queued.callback = callback;
+  queued.queued = base::TimeTicks::Now();
+  queues_[request_class].push_back(queued);
+  queued_[request] = request_class;
+
+  ++stats_.deferred_requests[request_class];
+  ++stats_.queue_depth[request_class];
+  stats_.max_queue_depth = std::max<int64>(stats_.max_queue_depth,
+                                           queued_.size());
+  return net::ERR_IO_PENDING;
+}
+
+void RequestScheduler::RemoveRequest(net::URLRequest* request) {
+  auto queued = queued_.find(request);
+  if (queued != queued_.end()) {
+    auto& queue = queues_[queued->second];
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+      if (it->request == request) {
+        queue.erase(it);
+        break;
+      }
+    }
+    --stats_.queue_depth[queued->second];
+    queued_.erase(queued);
+    return;
+  }
+
+  auto running = running_.find(request);
+  if (running == running_.end())
+    return;
+
+  auto per_origin = running_per_origin_.find(running->second.origin);
+  if (--per_origin->second == 0)
+    running_per_origin_.erase(per_origin);
+  if (running->second.request_class != REQUEST_CLASS_INTERACTIVE)
+    --running_non_interactive_;
+  running_.erase(running);
+
+  StartQueuedRequests();
+}
+
+bool RequestScheduler::CanStart(RequestClass request_class,
+                                const std::string& origin) const {
+  if (!config_.enabled)
+    return true;
+
+  if (running_.size() >= config_.max_requests)
+    return false;
+
+  if (request_class != REQUEST_CLASS_INTERACTIVE) {
+    size_t limit = config_.max_requests > config_.reserved_interactive_requests
+        ? config_.max_requests - config_.reserved_interactive_requests
+        : 0;
+    if (running_non_interactive_ >= limit)
+      return false;
+  }
+
+  auto it = running_per_origin_.find(origin);
+  return it == running_per_origin_.end() ||
+      it->second < config_.max_requests_per_origin;
+}
+
+void RequestScheduler::Start(net::URLRequest* request,
+                             RequestClass request_class,
+                             const std::string& origin) {
+  RunningRequest& running = running_[request];
+  running.request_class = request_class;
+  running.origin = origin;
+  ++running_per_origin_[origin];
+  if (request_class != REQUEST_CLASS_INTERACTIVE)
+    ++running_non_interactive_;
+}
+
+void RequestScheduler::StartQueuedRequests() {
+  // Running a callback can complete or cancel other requests and re-enter
+  // this method, so the state is brought up to date before each one runs.
+  QueuedRequest next;
+  while (PopStartableRequest(&next))
+    next.callback.Run(net::OK);
+}
+
+bool RequestScheduler::PopStartableRequest(QueuedRequest* next) {
+  for (int i = 0; i < REQUEST_CLASS_COUNT; ++i) {
+    auto request_class = static_cast<RequestClass>(i);
+    auto& queue = queues_[i];
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+      if (!CanStart(request_class, it->origin))
+        continue;
+
+      *next = *it;
+      queue.erase(it);
+      queued_.erase(next->request);
+      --stats_.queue_depth[i];
+      stats_.wait_time[i].Add(base::TimeTicks::Now() - next->queued);
+
+      Start(next->request, request_class, next->origin);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace brightray
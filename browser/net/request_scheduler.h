@@ -0,0 +1,129 @@
+#ifndef BRIGHTRAY_BROWSER_NET_REQUEST_SCHEDULER_H_
+#define BRIGHTRAY_BROWSER_NET_REQUEST_SCHEDULER_H_
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "browser/net/network_stats.h"
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "net/base/completion_callback.h"
+
+namespace net {
+class URLRequest;
+}
+
+namespace brightray {
+
+// How urgently a request needs to run. Classes are served in this order, so
+// an interactive request always jumps ahead of queued background ones.
+enum RequestClass {
+  // Requests a user is waiting on, e.g. frame loads and their subresources.
+  REQUEST_CLASS_INTERACTIVE,
+  // Requests no one is watching, e.g. the embedder's own sync traffic.
+  REQUEST_CLASS_BACKGROUND,
+  // Speculative requests that can wait until everything else is done.
+  REQUEST_CLASS_PREFETCH,
+  REQUEST_CLASS_COUNT,
+};
+
+struct RequestSchedulerConfig {
+  RequestSchedulerConfig()
+      : enabled(false),
+        max_requests(32),
+        max_requests_per_origin(6),
+        reserved_interactive_requests(8) {
+  }
+
+  // When false, every request starts immediately.
+  bool enabled;
+  // Requests that may run at once across all origins.
+  size_t max_requests;
+  // Requests that may run at once to any single origin.
+  size_t max_requests_per_origin;
+  // Slots out of |max_requests| that background and prefetch requests may
+  // not use, so a burst of them can't starve page loads.
+  size_t reserved_interactive_requests;
+};
+
+// Only accessed on the IO thread.
+struct RequestSchedulerStats {
+  RequestSchedulerStats();
+
+  // Requests seen, per RequestClass.
+  int64 requests[REQUEST_CLASS_COUNT];
+  // Requests that had to wait for a slot, per RequestClass.
+  int64 deferred_requests[REQUEST_CLASS_COUNT];
+  // Requests waiting right now, per RequestClass.
+  int64 queue_depth[REQUEST_CLASS_COUNT];
+  // The deepest the queues have been, all classes combined.
+  int64 max_queue_depth;
+  // How long deferred requests waited, per RequestClass.
+  NetworkTimingHistogram wait_time[REQUEST_CLASS_COUNT];
+};
+
+// Limits how many requests run at once, globally and per origin, and
+// decides which queued request runs next when one finishes. Owned by
+// NetworkDelegate and only used on the IO thread.
+class RequestScheduler {
+ public:
+  RequestScheduler();
+  ~RequestScheduler();
+
+  void SetConfig(const RequestSchedulerConfig& config);
+
+  // Returns net::OK if |request| may start now. Otherwise queues it and
+  // returns net::ERR_IO_PENDING; |callback| is run once it may start.
+  int ScheduleRequest(net::URLRequest* request,
+                      RequestClass request_class,
+                      const net::CompletionCallback& callback);
+
+  // Frees the slot or queue entry held by |request|. Safe to call more than
+  // once, and for requests that were never scheduled.
+  void RemoveRequest(net::URLRequest* request);
+
+  const RequestSchedulerStats& stats() const { return stats_; }
+
+ private:
+  struct QueuedRequest {
+    net::URLRequest* request;
+    std::string origin;
+    net::CompletionCallback callback;
+    base::TimeTicks queued;
+  };
+  typedef std::list<QueuedRequest> Queue;
+
+  struct RunningRequest {
+    RequestClass request_class;
+    std::string origin;
+  };
+
+  bool CanStart(RequestClass request_class, const std::string& origin) const;
+  void Start(net::URLRequest* request,
+             RequestClass request_class,
+             const std::string& origin);
+  // Starts queued requests for as long as there are free slots.
+  void StartQueuedRequests();
+  bool PopStartableRequest(QueuedRequest* next);
+
+  RequestSchedulerConfig config_;
+
+  Queue queues_[REQUEST_CLASS_COUNT];
+  // Maps each queued request to its RequestClass.
+  std::map<net::URLRequest*, RequestClass> queued_;
+  std::map<net::URLRequest*, RunningRequest> running_;
+  // Number of running requests per origin.
+  std::map<std::string, size_t> running_per_origin_;
+  // Number of running background and prefetch requests.
+  size_t running_non_interactive_;
+
+  RequestSchedulerStats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(RequestScheduler);
+};
+
+}  // namespace brightray
+
+#endif
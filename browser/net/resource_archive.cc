@@ -0,0 +1,180 @@
+#include "browser/net/resource_archive.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "base/sys_byteorder.h"
+
+#if defined(OS_POSIX)
+#include <sys/mman.h>
+#endif
+
+namespace brightray {
+
+namespace {
+
+// See tools/pack_archive.py for a description of the format. All integers
+// are little-endian uint32s.
+const char kMagic[] = { 'B', 'R', 'A', 'R' };
+const uint32 kVersion = 1;
+const uint32 kNoEntry = 0xffffffff;
+const uint32 kFlagGzipped = 1 << 0;
+
+struct Header {
+  char magic[4];
+  uint32 version;
+  uint32 bucket_count;
+  uint32 entry_count;
+};
+
+struct EntryRecord {
+  uint32 hash;
+  uint32 next;
+  uint32 path_offset;
+  uint32 path_length;
+  uint32 mime_type_offset;
+  uint32 mime_type_length;
+  uint32 data_offset;
+  uint32 data_length;
+  uint32 flags;
+};
+
+COMPILE_ASSERT(sizeof(Header) == 16, header_must_be_packed);
+COMPILE_ASSERT(sizeof(EntryRecord) == 36, entry_record_must_be_packed);
+
+// 32-bit FNV-1a.
+uint32 HashPath(const base::StringPiece& path) {
+  uint32 hash = 2166136261u;
+  for (size_t i = 0; i < path.size(); ++i) {
+    hash ^= static_cast<uint8>(path[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint32 FromLE(uint32 value) {
+  return base::ByteSwapToLE32(value);
+}
+
+bool IsInBounds(uint32 offset, uint32 length, size_t file_length) {
+  return offset <= file_length && length <= file_length - offset;
+}
+
+}  // namespace
+
+ResourceArchive::ResourceArchive(const base::FilePath& path)
+    : path_(path),
+      state_(STATE_NOT_OPENED) {
+}
+
+ResourceArchive::~ResourceArchive() {
+}
+
+bool ResourceArchive::Open() {
+  base::AutoLock locker(lock_);
+  if (state_ == STATE_NOT_OPENED) {
+    if (file_.Initialize(path_) && ValidateIndex()) {
+      state_ = STATE_OPENED;
+#if defined(OS_POSIX)
+      // Entries are copied out on the IO thread, so start paging the whole
+      // archive in now rather than faulting on it there.
+      madvise(const_cast<uint8*>(file_.data()), file_.length(),
+              MADV_WILLNEED);
+#endif
+    } else {
+      LOG(ERROR) << "Failed to open resource archive " << path_.value();
+      state_ = STATE_FAILED;
+    }
+  }
+  return state_ == STATE_OPENED;
+}
+
+bool ResourceArchive::IsOpenFinished() const {
+  base::AutoLock locker(lock_);
+  return state_ != STATE_NOT_OPENED;
+}
+
+bool ResourceArchive::Find(const base::StringPiece& path,
+                           Entry* entry) const {
+  DCHECK_EQ(state_, STATE_OPENED);
+
+  auto header = reinterpret_cast<const Header*>(file_.data());
+  auto buckets = reinterpret_cast<const uint32*>(header + 1);
+  uint32 bucket_count = FromLE(header->bucket_count);
+  auto records =
+      reinterpret_cast<const EntryRecord*>(buckets + bucket_count);
+  auto file_data = reinterpret_cast<const char*>(file_.data());
+
+  uint32 hash = HashPath(path);
+  for (uint32 i = FromLE(buckets[hash % bucket_count]); i != kNoEntry;
+       i = FromLE(records[i].next)) {
+    const auto& record = records[i];
+    if (FromLE(record.hash) != hash)
+      continue;
+    base::StringPiece record_path(file_data + FromLE(record.path_offset),
+                                  FromLE(record.path_length));
+    if (record_path != path)
+      continue;
+
+    entry->data.set(file_data + FromLE(record.data_offset),
+                    FromLE(record.data_length));
+    entry->mime_type.set(file_data + FromLE(record.mime_type_offset),
+                         FromLE(record.mime_type_length));
+    entry->gzipped = (FromLE(record.flags) & kFlagGzipped) != 0;
+    return true;
+  }
+  return false;
+}
+
+bool ResourceArchive::ValidateIndex() const {
+  lock_.AssertAcquired();
+
+  // Everything Find() reads is checked here once, so lookups can trust the
+  // index.
+  size_t length = file_.length();
+  if (length < sizeof(Header))
+    return false;
+
+  auto header = reinterpret_cast<const Header*>(file_.data());
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      FromLE(header->version) != kVersion)
+    return false;
+
+  uint32 bucket_count = FromLE(header->bucket_count);
+  uint32 entry_count = FromLE(header->entry_count);
+  if (bucket_count == 0 || entry_count == kNoEntry)
+    return false;
+  uint64 index_size = sizeof(Header) +
+      static_cast<uint64>(bucket_count) * sizeof(uint32) +
+      static_cast<uint64>(entry_count) * sizeof(EntryRecord);
+  if (index_size > length)
+    return false;
+
+  auto buckets = reinterpret_cast<const uint32*>(header + 1);
+  for (uint32 i = 0; i < bucket_count; ++i) {
+    uint32 first = FromLE(buckets[i]);
+    if (first != kNoEntry && first >= entry_count)
+      return false;
+  }
+
+  // Chains must only move forward through the records, which rules out
+  // cycles.
+  auto records = reinterpret_cast<const EntryRecord*>(buckets + bucket_count);
+  for (uint32 i = 0; i < entry_count; ++i) {
+    const auto& record = records[i];
+    uint32 next = FromLE(record.next);
+    if (next != kNoEntry && (next >= entry_count || next <= i))
+      return false;
+    if (!IsInBounds(FromLE(record.path_offset),
+                    FromLE(record.path_length), length) ||
+        !IsInBounds(FromLE(record.mime_type_offset),
+                    FromLE(record.mime_type_length), length) ||
+        !IsInBounds(FromLE(record.data_offset),
+                    FromLE(record.data_length), length))
+      return false;
+  }
+
+  return true;
+}
+
+}  // namespace brightray
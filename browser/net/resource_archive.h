@@ -0,0 +1,73 @@
+#ifndef BRIGHTRAY_BROWSER_NET_RESOURCE_ARCHIVE_H_
+#define BRIGHTRAY_BROWSER_NET_RESOURCE_ARCHIVE_H_
+
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/memory/ref_counted.h"
+#include "base/strings/string_piece.h"
+#include "base/synchronization/lock.h"
+
+namespace brightray {
+
+// A read-only archive of resources, memory-mapped in one go and indexed by
+// a hash table stored in the file itself, so looking up a resource neither
+// touches the file system nor parses anything. Archives are built by
+// tools/pack_archive.py, which also documents the format.
+class ResourceArchive : public base::RefCountedThreadSafe<ResourceArchive> {
+ public:
+  struct Entry {
+    Entry() : gzipped(false) {}
+
+    base::StringPiece data;
+    base::StringPiece mime_type;
+    // True if |data| is gzipped and should be sent with
+    // "Content-Encoding: gzip".
+    bool gzipped;
+  };
+
+  explicit ResourceArchive(const base::FilePath& path);
+
+  // Maps the file, checks that its index is consistent and asks the OS to
+  // page the whole file in. This blocks, so call it on the FILE thread. Returns whether the archive can be used;
+  // calling it again after it has finished returns the same answer without
+  // doing any work.
+  bool Open();
+
+  // Whether Open() has finished, successfully or not. Can be called on any
+  // thread.
+  bool IsOpenFinished() const;
+
+  // Looks up |path| (e.g. "js/app.js") in the archive. Must only be called
+  // after Open() has succeeded; can be called on any thread. The returned
+  // data stays valid for as long as the archive.
+  bool Find(const base::StringPiece& path, Entry* entry) const;
+
+  const base::FilePath& path() const { return path_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<ResourceArchive>;
+
+  enum State {
+    STATE_NOT_OPENED,
+    STATE_OPENED,
+    STATE_FAILED,
+  };
+
+  ~ResourceArchive();
+
+  bool ValidateIndex() const;
+
+  base::FilePath path_;
+
+  // Guards |state_| and the call to Initialize() on |file_|. Once |state_|
+  // is STATE_OPENED, |file_| never changes again and can be read without it.
+  mutable base::Lock lock_;
+  State state_;
+  base::MemoryMappedFile file_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResourceArchive);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,370 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE-CHROMIUM file.
+
+#include "browser/net/sqlite_server_bound_cert_store.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/sequenced_task_runner.h"
+#include "base/stl_util.h"
+#include "base/synchronization/lock.h"
+#include "sql/connection.h"
+#include "sql/meta_table.h"
+#include "sql/statement.h"
+#include "sql/transaction.h"
+
+namespace brightray {
+
+namespace {
+
+// Version number of the database.
+const int kCurrentVersionNumber = 1;
+const int kCompatibleVersionNumber = 1;
+
+// Pending changes are written out this often, or as soon as this many have
+// accumulated, whichever comes first.
+const int kCommitIntervalMs = 30 * 1000;
+const size_t kCommitAfterBatchSize = 512;
+
+}  // namespace
+
+// Does all database work on the background task runner. Changes made by the
+// IO thread are queued up under |lock_| and flushed in one transaction.
+class SQLiteServerBoundCertStore::Backend
+    : public base::RefCountedThreadSafe<SQLiteServerBoundCertStore::Backend> {
+ public:
+  Backend(
+      const base::FilePath& path,
+      const scoped_refptr<base::SequencedTaskRunner>& background_task_runner)
+      : path_(path),
+        background_task_runner_(background_task_runner),
+        num_pending_(0) {
+  }
+
+  void Load(const LoadedCallback& loaded_callback);
+  void AddServerBoundCert(
+      const net::DefaultServerBoundCertStore::ServerBoundCert& cert);
+  void DeleteServerBoundCert(
+      const net::DefaultServerBoundCertStore::ServerBoundCert& cert);
+
+  // Commits any pending changes and closes the database.
+  void Close();
+
+ private:
+  friend class base::RefCountedThreadSafe<Backend>;
+
+  class PendingOperation {
+   public:
+    enum OperationType {
+      CERT_ADD,
+      CERT_DELETE,
+    };
+
+    PendingOperation(
+        OperationType op,
+        const net::DefaultServerBoundCertStore::ServerBoundCert& cert)
+        : op_(op), cert_(cert) {}
+
+    OperationType op() const { return op_; }
+    const net::DefaultServerBoundCertStore::ServerBoundCert& cert() const {
+      return cert_;
+    }
+
+   private:
+    OperationType op_;
+    net::DefaultServerBoundCertStore::ServerBoundCert cert_;
+  };
+
+  typedef std::vector<PendingOperation*> PendingOperationsList;
+
+  ~Backend() {
+    DCHECK(!db_.get()) << "Close should have already been called.";
+    STLDeleteElements(&pending_);
+  }
+
+  void LoadOnBackgroundThread(
+      scoped_refptr<base::MessageLoopProxy> client_task_runner,
+      const LoadedCallback& loaded_callback);
+  bool EnsureDatabaseVersion();
+
+  void BatchOperation(
+      PendingOperation::OperationType op,
+      const net::DefaultServerBoundCertStore::ServerBoundCert& cert);
+  void Commit();
+  void CloseOnBackgroundThread();
+
+  base::FilePath path_;
+  scoped_refptr<base::SequencedTaskRunner> background_task_runner_;
+
+  scoped_ptr<sql::Connection> db_;
+  sql::MetaTable meta_table_;
+
+  // Guards |pending_| and |num_pending_|.
+  base::Lock lock_;
+  PendingOperationsList pending_;
+  size_t num_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(Backend);
+};
+
+void SQLiteServerBoundCertStore::Backend::Load(
+    const LoadedCallback& loaded_callback) {
+  background_task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&Backend::LoadOnBackgroundThread,
+                 this,
+                 base::MessageLoopProxy::current(),
+                 loaded_callback));
+}
+
+void SQLiteServerBoundCertStore::Backend::LoadOnBackgroundThread(
+    scoped_refptr<base::MessageLoopProxy> client_task_runner,
+    const LoadedCallback& loaded_callback) {
+  scoped_ptr<ScopedVector<net::DefaultServerBoundCertStore::ServerBoundCert> >
+      certs(new ScopedVector<
+          net::DefaultServerBoundCertStore::ServerBoundCert>());
+
+  // Certificates are loaded from the database on a best-effort basis; if
+  // anything goes wrong we start out with an empty store.
+  auto dir = path_.DirName();
+  if (!base::PathExists(dir) && !file_util::CreateDirectory(dir)) {
+    client_task_runner->PostTask(
+        FROM_HERE, base::Bind(loaded_callback, base::Passed(&certs)));
+    return;
+  }
+
+  db_.reset(new sql::Connection);
+  if (!db_->Open(path_) || !EnsureDatabaseVersion()) {
+    LOG(WARNING) << "Unable to open server bound cert DB at "
+                 << path_.value();
+    db_.reset();
+    client_task_runner->PostTask(
+        FROM_HERE, base::Bind(loaded_callback, base::Passed(&certs)));
+    return;
+  }
+
+  db_->Preload();
+
+  sql::Statement smt(db_->GetUniqueStatement(
+      "SELECT origin, private_key, cert, expiration_time, creation_time "
+      "FROM origin_bound_certs"));
+  if (smt.is_valid()) {
+    while (smt.Step()) {
+      std::string private_key_from_db, cert_from_db;
+      smt.ColumnBlobAsString(1, &private_key_from_db);
+      smt.ColumnBlobAsString(2, &cert_from_db);
+      certs->push_back(new net::DefaultServerBoundCertStore::ServerBoundCert(
+          smt.ColumnString(0),
+          base::Time::FromInternalValue(smt.ColumnInt64(4)),
+          base::Time::FromInternalValue(smt.ColumnInt64(3)),
+          private_key_from_db,
+          cert_from_db));
+    }
+  }
+
+  client_task_runner->PostTask(
+      FROM_HERE, base::Bind(loaded_callback, base::Passed(&certs)));
+}
+
+bool SQLiteServerBoundCertStore::Backend::EnsureDatabaseVersion() {
+  if (!meta_table_.Init(
+          db_.get(), kCurrentVersionNumber, kCompatibleVersionNumber))
+    return false;
+
+  if (meta_table_.GetCompatibleVersionNumber() > kCurrentVersionNumber) {
+    LOG(WARNING) << "Server bound cert database is too new.";
+    return false;
+  }
+
+  if (db_->DoesTableExist("origin_bound_certs"))
+    return true;
+
+  return db_->Execute(
+      "CREATE TABLE origin_bound_certs ("
+      "origin TEXT NOT NULL UNIQUE PRIMARY KEY,"
+      "private_key BLOB NOT NULL,"
+      "cert BLOB NOT NULL,"
+      "expiration_time INTEGER,"
+      "creation_time INTEGER)");
+}
+
+void SQLiteServerBoundCertStore::Backend::AddServerBoundCert(
+    const net::DefaultServerBoundCertStore::ServerBoundCert& cert) {
+  BatchOperation(PendingOperation::CERT_ADD, cert);
+}
+
+void SQLiteServerBoundCertStore::Backend::DeleteServerBoundCert(
+    const net::DefaultServerBoundCertStore::ServerBoundCert& cert) {
+  BatchOperation(PendingOperation::CERT_DELETE, cert);
+}
+
+void SQLiteServerBoundCertStore::Backend::BatchOperation(
+    PendingOperation::OperationType op,
+    const net::DefaultServerBoundCertStore::ServerBoundCert& cert) {
+  scoped_ptr<PendingOperation> po(new PendingOperation(op, cert));
+
+  size_t num_pending;
+  {
+    base::AutoLock locked(lock_);
+    pending_.push_back(po.release());
+    num_pending = ++num_pending_;
+  }
+
+  if (num_pending == 1) {
+    // We've gotten our first entry for this batch, fire off the timer.
+    background_task_runner_->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&Backend::Commit, this),
+        base::TimeDelta::FromMilliseconds(kCommitIntervalMs));
+  } else if (num_pending == kCommitAfterBatchSize) {
+    // We've reached a big enough batch, fire off a commit now.
+    background_task_runner_->PostTask(
+        FROM_HERE, base::Bind(&Backend::Commit, this));
+  }
+}
+
+void SQLiteServerBoundCertStore::Backend::Commit() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  PendingOperationsList ops;
+  {
+    base::AutoLock locked(lock_);
+    pending_.swap(ops);
+    num_pending_ = 0;
+  }
+
+  // Maybe an old timer fired or we are already Close()'ed.
+  if (!db_.get() || ops.empty()) {
+    STLDeleteElements(&ops);
+    return;
+  }
+
+  sql::Statement add_smt(db_->GetCachedStatement(SQL_FROM_HERE,
+      "INSERT INTO origin_bound_certs (origin, private_key, cert, "
+      "expiration_time, creation_time) VALUES (?,?,?,?,?)"));
+  sql::Statement del_smt(db_->GetCachedStatement(SQL_FROM_HERE,
+      "DELETE FROM origin_bound_certs WHERE origin=?"));
+  if (!add_smt.is_valid() || !del_smt.is_valid()) {
+    STLDeleteElements(&ops);
+    return;
+  }
+
+  sql::Transaction transaction(db_.get());
+  if (!transaction.Begin()) {
+    STLDeleteElements(&ops);
+    return;
+  }
+
+  for (auto it = ops.begin(); it != ops.end(); ++it) {
+    // Free the certs as we commit them to the database.
+    scoped_ptr<PendingOperation> po(*it);
+    const auto& cert = po->cert();
+    switch (po->op()) {
+      case PendingOperation::CERT_ADD: {
+        add_smt.Reset(true);
+        add_smt.BindString(0, cert.server_identifier());
+        const std::string& private_key = cert.private_key();
+        add_smt.BindBlob(1, private_key.data(), private_key.size());
+        const std::string& cert_data = cert.cert();
+        add_smt.BindBlob(2, cert_data.data(), cert_data.size());
+        add_smt.BindInt64(3, cert.expiration_time().ToInternalValue());
+        add_smt.BindInt64(4, cert.creation_time().ToInternalValue());
+        if (!add_smt.Run())
+          NOTREACHED() << "Could not add a server bound cert to the DB.";
+        break;
+      }
+      case PendingOperation::CERT_DELETE:
+        del_smt.Reset(true);
+        del_smt.BindString(0, cert.server_identifier());
+        if (!del_smt.Run())
+          NOTREACHED() << "Could not delete a server bound cert from the DB.";
+        break;
+      default:
+        NOTREACHED();
+        break;
+    }
+  }
+  transaction.Commit();
+}
+
+void SQLiteServerBoundCertStore::Backend::Close() {
+  // Must close the backend on the background thread.
+  background_task_runner_->PostTask(
+      FROM_HERE, base::Bind(&Backend::CloseOnBackgroundThread, this));
+}
+
+void SQLiteServerBoundCertStore::Backend::CloseOnBackgroundThread() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+  // Commit any pending operations.
+  Commit();
+  db_.reset();
+}
+
+CountingServerBoundCertStore::CountingServerBoundCertStore(
+    PersistentStore* persistent_store)
+    : net::DefaultServerBoundCertStore(persistent_store),
+      stored_cert_count_(0) {
+}
+
+CountingServerBoundCertStore::~CountingServerBoundCertStore() {
+}
+
+void CountingServerBoundCertStore::SetServerBoundCert(
+    const std::string& server_identifier,
+    base::Time creation_time,
+    base::Time expiration_time,
+    const std::string& private_key,
+    const std::string& cert) {
+  ++stored_cert_count_;
+  net::DefaultServerBoundCertStore::SetServerBoundCert(
+      server_identifier, creation_time, expiration_time, private_key, cert);
+}
+
+SQLiteServerBoundCertStore::SQLiteServerBoundCertStore(
+    const base::FilePath& path,
+    const scoped_refptr<base::SequencedTaskRunner>& background_task_runner)
+    : backend_(new Backend(path, background_task_runner)),
+      loaded_cert_count_(0) {
+}
+
+SQLiteServerBoundCertStore::~SQLiteServerBoundCertStore() {
+  backend_->Close();
+}
+
+void SQLiteServerBoundCertStore::Load(const LoadedCallback& loaded_callback) {
+  backend_->Load(base::Bind(&SQLiteServerBoundCertStore::OnLoaded,
+                            this,
+                            loaded_callback));
+}
+
+void SQLiteServerBoundCertStore::AddServerBoundCert(
+    const net::DefaultServerBoundCertStore::ServerBoundCert& cert) {
+  backend_->AddServerBoundCert(cert);
+}
+
+void SQLiteServerBoundCertStore::DeleteServerBoundCert(
+    const net::DefaultServerBoundCertStore::ServerBoundCert& cert) {
+  backend_->DeleteServerBoundCert(cert);
+}
+
+void SQLiteServerBoundCertStore::SetForceKeepSessionState() {
+  // Certificates are never cleared on exit, so there's nothing to force.
+}
+
+void SQLiteServerBoundCertStore::OnLoaded(
+    const LoadedCallback& loaded_callback,
+    scoped_ptr<ScopedVector<
+        net::DefaultServerBoundCertStore::ServerBoundCert> > certs) {
+  loaded_cert_count_ = certs->size();
+  loaded_callback.Run(certs.Pass());
+}
+
+}  // namespace brightray
@@ -0,0 +1,104 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE-CHROMIUM file.
+
+#ifndef BRIGHTRAY_BROWSER_NET_SQLITE_SERVER_BOUND_CERT_STORE_H_
+#define BRIGHTRAY_BROWSER_NET_SQLITE_SERVER_BOUND_CERT_STORE_H_
+
+#include <string>
+
+#include "base/memory/ref_counted.h"
+#include "net/ssl/default_server_bound_cert_store.h"
+
+namespace base {
+class FilePath;
+class SequencedTaskRunner;
+}
+
+namespace brightray {
+
+// Counters for server-bound (channel ID) certificates. Only accessed on the
+// IO thread.
+struct ServerBoundCertStats {
+  ServerBoundCertStats()
+      : loaded_certs(0),
+        requests(0),
+        reused_certs(0),
+        generated_certs(0) {
+  }
+
+  // Certificates read back from disk at startup.
+  int64 loaded_certs;
+  // Requests for a certificate made by TLS handshakes.
+  int64 requests;
+  // Requests answered with a certificate that already existed.
+  int64 reused_certs;
+  // Key pairs that were generated and stored.
+  int64 generated_certs;
+};
+
+// The in-memory store of server-bound certificates. Counts the certificates
+// ServerBoundCertService stores, which it only does once it has generated
+// one.
+class CountingServerBoundCertStore : public net::DefaultServerBoundCertStore {
+ public:
+  // |persistent_store| may be null.
+  explicit CountingServerBoundCertStore(PersistentStore* persistent_store);
+  virtual ~CountingServerBoundCertStore();
+
+  int64 stored_cert_count() const { return stored_cert_count_; }
+
+  // net::DefaultServerBoundCertStore:
+  virtual void SetServerBoundCert(const std::string& server_identifier,
+                                  base::Time creation_time,
+                                  base::Time expiration_time,
+                                  const std::string& private_key,
+                                  const std::string& cert) OVERRIDE;
+
+ private:
+  int64 stored_cert_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingServerBoundCertStore);
+};
+
+// Stores server-bound certificates in a SQLite database so they survive
+// restarts. Reads and writes happen on |background_task_runner|, and writes
+// are batched into a single transaction every few seconds.
+class SQLiteServerBoundCertStore
+    : public net::DefaultServerBoundCertStore::PersistentStore {
+ public:
+  SQLiteServerBoundCertStore(
+      const base::FilePath& path,
+      const scoped_refptr<base::SequencedTaskRunner>& background_task_runner);
+
+  // Number of certificates that Load() read from disk. Only valid on the
+  // thread Load() was called on, once it has finished.
+  int loaded_cert_count() const { return loaded_cert_count_; }
+
+  // net::DefaultServerBoundCertStore::PersistentStore:
+  virtual void Load(const LoadedCallback& loaded_callback) OVERRIDE;
+  virtual void AddServerBoundCert(
+      const net::DefaultServerBoundCertStore::ServerBoundCert& cert) OVERRIDE;
+  virtual void DeleteServerBoundCert(
+      const net::DefaultServerBoundCertStore::ServerBoundCert& cert) OVERRIDE;
+  virtual void SetForceKeepSessionState() OVERRIDE;
+
+ private:
+  class Backend;
+
+  virtual ~SQLiteServerBoundCertStore();
+
+  void OnLoaded(
+      const LoadedCallback& loaded_callback,
+      scoped_ptr<ScopedVector<
+          net::DefaultServerBoundCertStore::ServerBoundCert> > certs);
+
+  scoped_refptr<Backend> backend_;
+  int loaded_cert_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(SQLiteServerBoundCertStore);
+};
+
+}  // namespace brightray
+
+#endif
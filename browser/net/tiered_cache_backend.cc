@@ -0,0 +1,725 @@
+#include "browser/net/tiered_cache_backend.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/strings/string_number_conversions.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+
+namespace brightray {
+
+namespace {
+
+// The HTTP cache stores headers, body and metadata in three streams.
+const int kNumStreams = 3;
+const int kMetadataStream = 2;
+
+void IgnoreCompletion(int result) {
+}
+
+void ReleaseBufferOnCompletion(scoped_refptr<net::IOBuffer> buffer,
+                               int result) {
+}
+
+// Wraps a pair of entries from the memory and disk tiers.
+class TieredEntry : public disk_cache::Entry {
+ public:
+  enum Mode {
+    // Created through the backend. Every write goes to both tiers and reads
+    // are answered from memory.
+    MODE_MIRRORED,
+    // Opened from the memory tier. Reads are answered from memory, and writes
+    // are forwarded to the disk copy once it has been opened.
+    MODE_MEMORY_HIT,
+    // Opened from the disk tier. Reads are answered from disk and copied into
+    // the memory tier as long as they cover the entry sequentially.
+    MODE_PROMOTING,
+  };
+
+  TieredEntry(Mode mode,
+              const std::string& key,
+              disk_cache::Entry* memory_entry,
+              disk_cache::Entry* disk_entry,
+              disk_cache::Backend* disk_backend,
+              HttpCacheStats* stats)
+      : mode_(mode),
+        key_(key),
+        memory_entry_(memory_entry),
+        disk_entry_(disk_entry),
+        disk_backend_(disk_backend),
+        stats_(stats),
+        pending_operations_(0),
+        opening_disk_entry_(false),
+        disk_entry_missing_(false),
+        doomed_(false),
+        closed_(false) {
+    std::fill(filled_, filled_ + kNumStreams, 0);
+  }
+
+  // disk_cache::Entry:
+  virtual void Doom() OVERRIDE {
+    doomed_ = true;
+    pending_writes_.clear();
+    if (memory_entry_)
+      memory_entry_->Doom();
+    if (disk_entry_)
+      disk_entry_->Doom();
+    else if (mode_ == MODE_MEMORY_HIT && !opening_disk_entry_)
+      disk_backend_->DoomEntry(key_, base::Bind(&IgnoreCompletion));
+  }
+
+  virtual void Close() OVERRIDE {
+    if (mode_ == MODE_PROMOTING && memory_entry_)
+      FinishPromotion();
+    closed_ = true;
+    MaybeDestroy();
+  }
+
+  virtual std::string GetKey() const OVERRIDE {
+    return key_;
+  }
+
+  virtual base::Time GetLastUsed() const OVERRIDE {
+    return read_entry()->GetLastUsed();
+  }
+
+  virtual base::Time GetLastModified() const OVERRIDE {
+    return read_entry()->GetLastModified();
+  }
+
+  virtual int32 GetDataSize(int index) const OVERRIDE {
+    return read_entry()->GetDataSize(index);
+  }
+
+  virtual int ReadData(int index,
+                       int offset,
+                       net::IOBuffer* buf,
+                       int buf_len,
+                       const CompletionCallback& callback) OVERRIDE {
+    if (mode_ != MODE_PROMOTING && memory_entry_)
+      return memory_entry_->ReadData(index, offset, buf, buf_len, callback);
+
+    ++pending_operations_;
+    int rv = disk_entry_->ReadData(index, offset, buf, buf_len,
+        base::Bind(&TieredEntry::OnDiskReadComplete,
+                   base::Unretained(this),
+                   index,
+                   offset,
+                   make_scoped_refptr(buf),
+                   callback));
+    if (rv != net::ERR_IO_PENDING) {
+      --pending_operations_;
+      CopyToMemory(index, offset, buf, rv);
+    }
+    return rv;
+  }
+
+  virtual int WriteData(int index,
+                        int offset,
+                        net::IOBuffer* buf,
+                        int buf_len,
+                        const CompletionCallback& callback,
+                        bool truncate) OVERRIDE {
+    if (memory_entry_) {
+      int rv = memory_entry_->WriteData(
+          index, offset, buf, buf_len, CompletionCallback(), truncate);
+      if (mode_ == MODE_PROMOTING) {
+        if (rv != buf_len || offset > filled_[index])
+          DropMemoryEntry();
+        else if (truncate)
+          filled_[index] = offset + buf_len;
+        else
+          filled_[index] = std::max(filled_[index], offset + buf_len);
+      } else if (rv != buf_len) {
+        // The memory tier is the only copy we can read from right now, so
+        // there is no way to recover from a failed write.
+        if (mode_ == MODE_MEMORY_HIT) {
+          Doom();
+          return rv;
+        }
+        DropMemoryEntry();
+      }
+    }
+
+    if (mode_ == MODE_MEMORY_HIT) {
+      MirrorWriteToDisk(index, offset, buf, buf_len, truncate);
+      return buf_len;
+    }
+
+    return disk_entry_->WriteData(
+        index, offset, buf, buf_len, callback, truncate);
+  }
+
+  virtual int ReadSparseData(int64 offset,
+                             net::IOBuffer* buf,
+                             int buf_len,
+                             const CompletionCallback& callback) OVERRIDE {
+    return sparse_entry()->ReadSparseData(offset, buf, buf_len, callback);
+  }
+
+  virtual int WriteSparseData(int64 offset,
+                              net::IOBuffer* buf,
+                              int buf_len,
+                              const CompletionCallback& callback) OVERRIDE {
+    return sparse_entry()->WriteSparseData(offset, buf, buf_len, callback);
+  }
+
+  virtual int GetAvailableRange(int64 offset,
+                                int len,
+                                int64* start,
+                                const CompletionCallback& callback) OVERRIDE {
+    return sparse_entry()->GetAvailableRange(offset, len, start, callback);
+  }
+
+  virtual bool CouldBeSparse() const OVERRIDE {
+    return read_entry()->CouldBeSparse();
+  }
+
+  virtual void CancelSparseIO() OVERRIDE {
+    sparse_entry()->CancelSparseIO();
+  }
+
+  virtual int ReadyForSparseIO(const CompletionCallback& callback) OVERRIDE {
+    return sparse_entry()->ReadyForSparseIO(callback);
+  }
+
+ private:
+  struct PendingWrite {
+    int index;
+    int offset;
+    scoped_refptr<net::IOBuffer> buffer;
+    int length;
+    bool truncate;
+  };
+
+  virtual ~TieredEntry() {
+  }
+
+  disk_cache::Entry* read_entry() const {
+    if (mode_ != MODE_PROMOTING && memory_entry_)
+      return memory_entry_;
+    return disk_entry_;
+  }
+
+  // Sparse entries are only ever kept on disk, so memory hits are never
+  // sparse.
+  disk_cache::Entry* sparse_entry() {
+    if (mode_ == MODE_MEMORY_HIT)
+      return memory_entry_;
+    if (disk_entry_ && memory_entry_)
+      DropMemoryEntry();
+    return disk_entry_ ? disk_entry_ : memory_entry_;
+  }
+
+  void DropMemoryEntry() {
+    DCHECK_NE(mode_, MODE_MEMORY_HIT);
+    memory_entry_->Doom();
+    memory_entry_->Close();
+    memory_entry_ = NULL;
+  }
+
+  void CopyToMemory(int index, int offset, net::IOBuffer* buf, int result) {
+    if (mode_ != MODE_PROMOTING || !memory_entry_ || closed_ || result < 0)
+      return;
+
+    // Only sequential reads produce a complete copy.
+    if (offset > filled_[index]) {
+      DropMemoryEntry();
+      return;
+    }
+    if (result == 0)
+      return;
+
+    int rv = memory_entry_->WriteData(
+        index, offset, buf, result, CompletionCallback(), false);
+    if (rv != result) {
+      DropMemoryEntry();
+      return;
+    }
+    filled_[index] = std::max(filled_[index], offset + result);
+  }
+
+  void OnDiskReadComplete(int index,
+                          int offset,
+                          scoped_refptr<net::IOBuffer> buf,
+                          const CompletionCallback& callback,
+                          int result) {
+    --pending_operations_;
+    CopyToMemory(index, offset, buf.get(), result);
+    // The caller might close us from its callback, and it doesn't matter if
+    // we are gone by the time it runs.
+    if (closed_)
+      MaybeDestroy();
+    callback.Run(result);
+  }
+
+  // Keeps the memory copy if the headers and body were read in full, which
+  // is the only case where it can answer future requests on its own.
+  void FinishPromotion() {
+    for (int i = 0; i < kMetadataStream; ++i) {
+      if (filled_[i] != disk_entry_->GetDataSize(i)) {
+        DropMemoryEntry();
+        return;
+      }
+    }
+
+    // Metadata is optional, so an incomplete copy is simply dropped.
+    if (filled_[kMetadataStream] !=
+        disk_entry_->GetDataSize(kMetadataStream)) {
+      memory_entry_->WriteData(kMetadataStream, 0, NULL, 0,
+                               CompletionCallback(), true);
+    }
+
+    ++stats_->promotions;
+    memory_entry_->Close();
+    memory_entry_ = NULL;
+  }
+
+  void MirrorWriteToDisk(int index,
+                         int offset,
+                         net::IOBuffer* buf,
+                         int buf_len,
+                         bool truncate) {
+    if (doomed_ || disk_entry_missing_)
+      return;
+
+    // The caller may reuse |buf| as soon as we return.
+    PendingWrite write;
+    write.index = index;
+    write.offset = offset;
+    write.buffer = new net::IOBuffer(std::max(buf_len, 1));
+    if (buf_len)
+      memcpy(write.buffer->data(), buf->data(), buf_len);
+    write.length = buf_len;
+    write.truncate = truncate;
+
+    if (disk_entry_) {
+      IssueDiskWrite(write);
+      return;
+    }
+
+    pending_writes_.push_back(write);
+    if (opening_disk_entry_)
+      return;
+
+    opening_disk_entry_ = true;
+    int rv = disk_backend_->OpenEntry(key_, &disk_entry_,
+        base::Bind(&TieredEntry::OnDiskEntryOpened, base::Unretained(this)));
+    if (rv != net::ERR_IO_PENDING)
+      OnDiskEntryOpened(rv);
+  }
+
+  void OnDiskEntryOpened(int result) {
+    opening_disk_entry_ = false;
+
+    if (result != net::OK) {
+      // The disk tier already evicted this entry, so there's nothing left to
+      // keep in sync.
+      disk_entry_ = NULL;
+      disk_entry_missing_ = true;
+      pending_writes_.clear();
+    } else if (doomed_) {
+      disk_entry_->Doom();
+    } else {
+      for (size_t i = 0; i < pending_writes_.size(); ++i)
+        IssueDiskWrite(pending_writes_[i]);
+      pending_writes_.clear();
+    }
+
+    if (closed_)
+      MaybeDestroy();
+  }
+
+  void IssueDiskWrite(const PendingWrite& write) {
+    disk_entry_->WriteData(write.index,
+                           write.offset,
+                           write.buffer.get(),
+                           write.length,
+                           base::Bind(&ReleaseBufferOnCompletion, write.buffer),
+                           write.truncate);
+  }
+
+  void MaybeDestroy() {
+    if (pending_operations_ || opening_disk_entry_)
+      return;
+
+    if (memory_entry_)
+      memory_entry_->Close();
+    if (disk_entry_)
+      disk_entry_->Close();
+    delete this;
+  }
+
+  Mode mode_;
+  std::string key_;
+  disk_cache::Entry* memory_entry_;
+  disk_cache::Entry* disk_entry_;
+  disk_cache::Backend* disk_backend_;
+  HttpCacheStats* stats_;
+
+  // Bytes of each stream that have been copied into |memory_entry_| while
+  // promoting.
+  int filled_[kNumStreams];
+
+  std::vector<PendingWrite> pending_writes_;
+  int pending_operations_;
+  bool opening_disk_entry_;
+  bool disk_entry_missing_;
+  bool doomed_;
+  bool closed_;
+
+  DISALLOW_COPY_AND_ASSIGN(TieredEntry);
+};
+
+}  // namespace
+
+struct TieredCacheBackend::PendingOperation {
+  PendingOperation(const std::string& key,
+                   disk_cache::Entry** entry,
+                   const CompletionCallback& callback)
+      : key(key),
+        entry(entry),
+        disk_entry(NULL),
+        callback(callback) {
+  }
+
+  std::string key;
+  disk_cache::Entry** entry;
+  disk_cache::Entry* disk_entry;
+  CompletionCallback callback;
+};
+
+TieredCacheBackend::TieredCacheBackend(
+    scoped_ptr<disk_cache::Backend> memory_backend,
+    scoped_ptr<disk_cache::Backend> disk_backend,
+    HttpCacheStats* stats)
+    : memory_backend_(memory_backend.Pass()),
+      disk_backend_(disk_backend.Pass()),
+      stats_(stats),
+      weak_factory_(this) {
+  DCHECK(memory_backend_ || disk_backend_);
+  DCHECK(stats_);
+}
+
+TieredCacheBackend::~TieredCacheBackend() {
+}
+
+net::CacheType TieredCacheBackend::GetCacheType() const {
+  return primary_backend()->GetCacheType();
+}
+
+int32 TieredCacheBackend::GetEntryCount() const {
+  return primary_backend()->GetEntryCount();
+}
+
+int TieredCacheBackend::OpenEntry(const std::string& key,
+                                  disk_cache::Entry** entry,
+                                  const CompletionCallback& callback) {
+  if (memory_backend_) {
+    // The memory backend always completes synchronously.
+    disk_cache::Entry* memory_entry = NULL;
+    if (memory_backend_->OpenEntry(key, &memory_entry,
+                                   CompletionCallback()) == net::OK) {
+      ++stats_->memory_hits;
+      if (!disk_backend_) {
+        *entry = memory_entry;
+      } else {
+        *entry = new TieredEntry(TieredEntry::MODE_MEMORY_HIT, key,
+                                 memory_entry, NULL, disk_backend_.get(),
+                                 stats_);
+      }
+      return net::OK;
+    }
+
+    if (!disk_backend_) {
+      ++stats_->misses;
+      return net::ERR_FAILED;
+    }
+  }
+
+  auto operation = new PendingOperation(key, entry, callback);
+  int rv = disk_backend_->OpenEntry(key, &operation->disk_entry,
+      base::Bind(&TieredCacheBackend::OnDiskEntryOpened,
+                 weak_factory_.GetWeakPtr(),
+                 operation));
+  if (rv == net::ERR_IO_PENDING)
+    return rv;
+  return FinishOpenFromDisk(operation, rv);
+}
+
+int TieredCacheBackend::CreateEntry(const std::string& key,
+                                    disk_cache::Entry** entry,
+                                    const CompletionCallback& callback) {
+  if (!disk_backend_)
+    return memory_backend_->CreateEntry(key, entry, callback);
+  if (!memory_backend_)
+    return disk_backend_->CreateEntry(key, entry, callback);
+
+  // Get rid of any stale copy so it can't shadow the new entry.
+  memory_backend_->DoomEntry(key, CompletionCallback());
+
+  auto operation = new PendingOperation(key, entry, callback);
+  int rv = disk_backend_->CreateEntry(key, &operation->disk_entry,
+      base::Bind(&TieredCacheBackend::OnDiskEntryCreated,
+                 weak_factory_.GetWeakPtr(),
+                 operation));
+  if (rv == net::ERR_IO_PENDING)
+    return rv;
+  return FinishCreateOnDisk(operation, rv);
+}
+
+int TieredCacheBackend::DoomEntry(const std::string& key,
+                                  const CompletionCallback& callback) {
+  if (memory_backend_) {
+    int rv = memory_backend_->DoomEntry(key, CompletionCallback());
+    if (!disk_backend_)
+      return rv;
+  }
+  return disk_backend_->DoomEntry(key, callback);
+}
+
+int TieredCacheBackend::DoomAllEntries(const CompletionCallback& callback) {
+  if (memory_backend_) {
+    int rv = memory_backend_->DoomAllEntries(CompletionCallback());
+    if (!disk_backend_)
+      return rv;
+  }
+  return disk_backend_->DoomAllEntries(callback);
+}
+
+int TieredCacheBackend::DoomEntriesBetween(base::Time initial_time,
+                                           base::Time end_time,
+                                           const CompletionCallback& callback) {
+  if (memory_backend_) {
+    int rv = memory_backend_->DoomEntriesBetween(
+        initial_time, end_time, CompletionCallback());
+    if (!disk_backend_)
+      return rv;
+  }
+  return disk_backend_->DoomEntriesBetween(initial_time, end_time, callback);
+}
+
+int TieredCacheBackend::DoomEntriesSince(base::Time initial_time,
+                                         const CompletionCallback& callback) {
+  if (memory_backend_) {
+    int rv = memory_backend_->DoomEntriesSince(
+        initial_time, CompletionCallback());
+    if (!disk_backend_)
+      return rv;
+  }
+  return disk_backend_->DoomEntriesSince(initial_time, callback);
+}
+
+int TieredCacheBackend::OpenNextEntry(void** iter,
+                                      disk_cache::Entry** next_entry,
+                                      const CompletionCallback& callback) {
+  return primary_backend()->OpenNextEntry(iter, next_entry, callback);
+}
+
+void TieredCacheBackend::EndEnumeration(void** iter) {
+  primary_backend()->EndEnumeration(iter);
+}
+
+void TieredCacheBackend::GetStats(
+    std::vector<std::pair<std::string, std::string> >* stats) {
+  primary_backend()->GetStats(stats);
+  stats->push_back(std::make_pair(
+      "Memory tier hits", base::Int64ToString(stats_->memory_hits)));
+  stats->push_back(std::make_pair(
+      "Disk tier hits", base::Int64ToString(stats_->disk_hits)));
+  stats->push_back(std::make_pair(
+      "Misses", base::Int64ToString(stats_->misses)));
+  stats->push_back(std::make_pair(
+      "Promotions", base::Int64ToString(stats_->promotions)));
+}
+
+void TieredCacheBackend::OnExternalCacheHit(const std::string& key) {
+  if (memory_backend_)
+    memory_backend_->OnExternalCacheHit(key);
+  if (disk_backend_)
+    disk_backend_->OnExternalCacheHit(key);
+}
+
+// static
+void TieredCacheBackend::OnDiskEntryOpened(
+    base::WeakPtr<TieredCacheBackend> backend,
+    PendingOperation* operation,
+    int result) {
+  if (!backend) {
+    if (result == net::OK)
+      operation->disk_entry->Close();
+    delete operation;
+    return;
+  }
+
+  CompletionCallback callback = operation->callback;
+  callback.Run(backend->FinishOpenFromDisk(operation, result));
+}
+
+// static
+void TieredCacheBackend::OnDiskEntryCreated(
+    base::WeakPtr<TieredCacheBackend> backend,
+    PendingOperation* operation,
+    int result) {
+  if (!backend) {
+    if (result == net::OK)
+      operation->disk_entry->Close();
+    delete operation;
+    return;
+  }
+
+  CompletionCallback callback = operation->callback;
+  callback.Run(backend->FinishCreateOnDisk(operation, result));
+}
+
+disk_cache::Backend* TieredCacheBackend::primary_backend() const {
+  return disk_backend_ ? disk_backend_.get() : memory_backend_.get();
+}
+
+int TieredCacheBackend::FinishOpenFromDisk(PendingOperation* operation,
+                                           int result) {
+  scoped_ptr<PendingOperation> owned_operation(operation);
+  if (result != net::OK) {
+    ++stats_->misses;
+    return result;
+  }
+
+  ++stats_->disk_hits;
+  if (!memory_backend_) {
+    *operation->entry = operation->disk_entry;
+    return net::OK;
+  }
+
+  // Start a memory copy that fills in as the entry is read.
+  disk_cache::Entry* memory_entry = NULL;
+  if (memory_backend_->CreateEntry(operation->key, &memory_entry,
+                                   CompletionCallback()) != net::OK)
+    memory_entry = NULL;
+
+  *operation->entry = new TieredEntry(TieredEntry::MODE_PROMOTING,
+                                      operation->key,
+                                      memory_entry,
+                                      operation->disk_entry,
+                                      disk_backend_.get(),
+                                      stats_);
+  return net::OK;
+}
+
+int TieredCacheBackend::FinishCreateOnDisk(PendingOperation* operation,
+                                           int result) {
+  scoped_ptr<PendingOperation> owned_operation(operation);
+  if (result != net::OK)
+    return result;
+
+  disk_cache::Entry* memory_entry = NULL;
+  if (memory_backend_->CreateEntry(operation->key, &memory_entry,
+                                   CompletionCallback()) != net::OK) {
+    *operation->entry = operation->disk_entry;
+    return net::OK;
+  }
+
+  *operation->entry = new TieredEntry(TieredEntry::MODE_MIRRORED,
+                                      operation->key,
+                                      memory_entry,
+                                      operation->disk_entry,
+                                      disk_backend_.get(),
+                                      stats_);
+  return net::OK;
+}
+
+struct TieredCacheBackendFactory::PendingBackend {
+  scoped_ptr<disk_cache::Backend> memory_backend;
+  scoped_ptr<disk_cache::Backend> disk_backend;
+  HttpCacheStats* stats;
+};
+
+TieredCacheBackendFactory::TieredCacheBackendFactory(
+    const HttpCacheConfig& config,
+    const base::FilePath& path,
+    base::MessageLoopProxy* cache_thread,
+    HttpCacheStats* stats)
+    : config_(config),
+      path_(path),
+      cache_thread_(cache_thread),
+      stats_(stats) {
+}
+
+TieredCacheBackendFactory::~TieredCacheBackendFactory() {
+}
+
+int TieredCacheBackendFactory::CreateBackend(
+    net::NetLog* net_log,
+    scoped_ptr<disk_cache::Backend>* backend,
+    const net::CompletionCallback& callback) {
+  scoped_ptr<PendingBackend> pending(new PendingBackend);
+  pending->stats = stats_;
+
+  if (config_.mode != HttpCacheConfig::MODE_DISK) {
+    // Creating a memory backend always completes synchronously.
+    int rv = disk_cache::CreateCacheBackend(net::MEMORY_CACHE,
+                                            net::CACHE_BACKEND_DEFAULT,
+                                            base::FilePath(),
+                                            config_.memory_max_bytes,
+                                            false,
+                                            NULL,
+                                            net_log,
+                                            &pending->memory_backend,
+                                            net::CompletionCallback());
+    if (rv != net::OK)
+      return rv;
+  }
+
+  if (config_.mode == HttpCacheConfig::MODE_MEMORY)
+    return FinishCreateBackend(pending.release(), backend, net::OK);
+
+  auto raw_pending = pending.release();
+  int rv = disk_cache::CreateCacheBackend(config_.disk_cache_type,
+      config_.disk_backend_type,
+      path_,
+      config_.disk_max_bytes,
+      true,
+      cache_thread_.get(),
+      net_log,
+      &raw_pending->disk_backend,
+      base::Bind(&TieredCacheBackendFactory::OnDiskBackendCreated,
+                 raw_pending,
+                 backend,
+                 callback));
+  if (rv == net::ERR_IO_PENDING)
+    return rv;
+  return FinishCreateBackend(raw_pending, backend, rv);
+}
+
+// static
+void TieredCacheBackendFactory::OnDiskBackendCreated(
+    PendingBackend* pending,
+    scoped_ptr<disk_cache::Backend>* backend,
+    const net::CompletionCallback& callback,
+    int result) {
+  callback.Run(FinishCreateBackend(pending, backend, result));
+}
+
+// static
+int TieredCacheBackendFactory::FinishCreateBackend(
+    PendingBackend* pending,
+    scoped_ptr<disk_cache::Backend>* backend,
+    int result) {
+  scoped_ptr<PendingBackend> owned_pending(pending);
+  if (result != net::OK) {
+    if (!pending->memory_backend)
+      return result;
+    LOG(WARNING) << "Unable to create the disk cache, falling back to a "
+                    "memory-only cache";
+    pending->disk_backend.reset();
+  }
+
+  backend->reset(new TieredCacheBackend(pending->memory_backend.Pass(),
+                                        pending->disk_backend.Pass(),
+                                        pending->stats));
+  return net::OK;
+}
+
+}  // namespace brightray
@@ -0,0 +1,124 @@
+#ifndef BRIGHTRAY_BROWSER_NET_TIERED_CACHE_BACKEND_H_
+#define BRIGHTRAY_BROWSER_NET_TIERED_CACHE_BACKEND_H_
+
+#include "browser/net/http_cache_config.h"
+
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "net/disk_cache/disk_cache.h"
+#include "net/http/http_cache.h"
+
+namespace base {
+class MessageLoopProxy;
+}
+
+namespace brightray {
+
+// A disk_cache::Backend that layers an in-memory backend in front of an
+// on-disk one. Either tier may be missing, in which case the backend simply
+// forwards to the other one while still keeping lookup statistics.
+//
+// Lookups consult the memory tier first. Disk entries that are read from
+// start to end are copied into the memory tier as they are read, so hot
+// resources stop touching the disk after their first use. Writes always go to
+// both tiers, which keeps the disk tier authoritative.
+class TieredCacheBackend : public disk_cache::Backend {
+ public:
+  // |stats| must outlive the backend.
+  TieredCacheBackend(scoped_ptr<disk_cache::Backend> memory_backend,
+                     scoped_ptr<disk_cache::Backend> disk_backend,
+                     HttpCacheStats* stats);
+  virtual ~TieredCacheBackend();
+
+  disk_cache::Backend* memory_backend() const { return memory_backend_.get(); }
+  disk_cache::Backend* disk_backend() const { return disk_backend_.get(); }
+  HttpCacheStats* stats() const { return stats_; }
+
+  // disk_cache::Backend:
+  virtual net::CacheType GetCacheType() const OVERRIDE;
+  virtual int32 GetEntryCount() const OVERRIDE;
+  virtual int OpenEntry(const std::string& key,
+                        disk_cache::Entry** entry,
+                        const CompletionCallback& callback) OVERRIDE;
+  virtual int CreateEntry(const std::string& key,
+                          disk_cache::Entry** entry,
+                          const CompletionCallback& callback) OVERRIDE;
+  virtual int DoomEntry(const std::string& key,
+                        const CompletionCallback& callback) OVERRIDE;
+  virtual int DoomAllEntries(const CompletionCallback& callback) OVERRIDE;
+  virtual int DoomEntriesBetween(base::Time initial_time,
+                                 base::Time end_time,
+                                 const CompletionCallback& callback) OVERRIDE;
+  virtual int DoomEntriesSince(base::Time initial_time,
+                               const CompletionCallback& callback) OVERRIDE;
+  virtual int OpenNextEntry(void** iter,
+                            disk_cache::Entry** next_entry,
+                            const CompletionCallback& callback) OVERRIDE;
+  virtual void EndEnumeration(void** iter) OVERRIDE;
+  virtual void GetStats(
+      std::vector<std::pair<std::string, std::string> >* stats) OVERRIDE;
+  virtual void OnExternalCacheHit(const std::string& key) OVERRIDE;
+
+ private:
+  struct PendingOperation;
+
+  static void OnDiskEntryOpened(base::WeakPtr<TieredCacheBackend> backend,
+                                PendingOperation* operation,
+                                int result);
+  static void OnDiskEntryCreated(base::WeakPtr<TieredCacheBackend> backend,
+                                 PendingOperation* operation,
+                                 int result);
+
+  // Returns the backend that holds the authoritative copy of each entry.
+  disk_cache::Backend* primary_backend() const;
+
+  int FinishOpenFromDisk(PendingOperation* operation, int result);
+  int FinishCreateOnDisk(PendingOperation* operation, int result);
+
+  scoped_ptr<disk_cache::Backend> memory_backend_;
+  scoped_ptr<disk_cache::Backend> disk_backend_;
+  HttpCacheStats* stats_;
+
+  base::WeakPtrFactory<TieredCacheBackend> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(TieredCacheBackend);
+};
+
+// Creates a TieredCacheBackend as described by an HttpCacheConfig.
+class TieredCacheBackendFactory : public net::HttpCache::BackendFactory {
+ public:
+  // |stats| must outlive the HttpCache that owns this factory.
+  TieredCacheBackendFactory(const HttpCacheConfig& config,
+                            const base::FilePath& path,
+                            base::MessageLoopProxy* cache_thread,
+                            HttpCacheStats* stats);
+  virtual ~TieredCacheBackendFactory();
+
+  virtual int CreateBackend(net::NetLog* net_log,
+                            scoped_ptr<disk_cache::Backend>* backend,
+                            const net::CompletionCallback& callback) OVERRIDE;
+
+ private:
+  struct PendingBackend;
+
+  static void OnDiskBackendCreated(PendingBackend* pending,
+                                   scoped_ptr<disk_cache::Backend>* backend,
+                                   const net::CompletionCallback& callback,
+                                   int result);
+  static int FinishCreateBackend(PendingBackend* pending,
+                                 scoped_ptr<disk_cache::Backend>* backend,
+                                 int result);
+
+  HttpCacheConfig config_;
+  base::FilePath path_;
+  scoped_refptr<base::MessageLoopProxy> cache_thread_;
+  HttpCacheStats* stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(TieredCacheBackendFactory);
+};
+
+}  // namespace brightray
+
+#endif
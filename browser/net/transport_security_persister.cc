@@ -0,0 +1,269 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE-CHROMIUM file.
+
+#include "browser/net/transport_security_persister.h"
+
+#include <set>
+
+#include "base/base64.h"
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/sequenced_task_runner.h"
+#include "base/task_runner_util.h"
+#include "base/values.h"
+#include "content/public/browser/browser_thread.h"
+#include "crypto/sha2.h"
+
+using content::BrowserThread;
+
+namespace brightray {
+
+namespace {
+
+const char kIncludeSubdomainsKey[] = "sts_include_subdomains";
+const char kPinsIncludeSubdomainsKey[] = "pkp_include_subdomains";
+const char kModeKey[] = "mode";
+const char kForceHTTPSValue[] = "force-https";
+const char kDefaultValue[] = "default";
+const char kCreatedKey[] = "created";
+const char kExpiryKey[] = "expiry";
+const char kDynamicSPKIHashesExpiryKey[] = "dynamic_spki_hashes_expiry";
+const char kDynamicSPKIHashesKey[] = "dynamic_spki_hashes";
+
+// Static preloads are refreshed on every launch, so this only needs to be
+// longer than a session.
+const int kPreloadMaxAgeDays = 365;
+
+std::string LoadState(const base::FilePath& path) {
+  std::string state;
+  if (!base::ReadFileToString(path, &state))
+    return std::string();
+  return state;
+}
+
+base::ListValue* SPKIHashesToListValue(const net::HashValueVector& hashes) {
+  auto list = new base::ListValue;
+  for (auto it = hashes.begin(); it != hashes.end(); ++it)
+    list->Append(new base::StringValue(it->ToString()));
+  return list;
+}
+
+void AddHSTSPreloadsWithExpiry(net::TransportSecurityState* state,
+                               const HSTSPreloadList& preloads,
+                               const base::Time& expiry) {
+  for (auto it = preloads.begin(); it != preloads.end(); ++it)
+    state->AddHSTS(it->host, expiry, it->include_subdomains);
+}
+
+void ListValueToSPKIHashes(const base::ListValue& list,
+                           net::HashValueVector* hashes) {
+  for (size_t i = 0; i < list.GetSize(); ++i) {
+    std::string hash_string;
+    net::HashValue hash;
+    if (list.GetString(i, &hash_string) && hash.FromString(hash_string))
+      hashes->push_back(hash);
+  }
+}
+
+}  // namespace
+
+void AddHSTSPreloads(net::TransportSecurityState* state,
+                     const HSTSPreloadList& preloads) {
+  AddHSTSPreloadsWithExpiry(
+      state,
+      preloads,
+      base::Time::Now() + base::TimeDelta::FromDays(kPreloadMaxAgeDays));
+}
+
+TransportSecurityPersister::TransportSecurityPersister(
+    net::TransportSecurityState* state,
+    const base::FilePath& profile_path,
+    const scoped_refptr<base::SequencedTaskRunner>& background_runner,
+    const HSTSPreloadList& preloads)
+    : transport_security_state_(state),
+      preload_expiry_(base::Time::Now() +
+                      base::TimeDelta::FromDays(kPreloadMaxAgeDays)),
+      writer_(profile_path.Append(FILE_PATH_LITERAL("TransportSecurity")),
+              background_runner.get()),
+      weak_factory_(this) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  // Preloads are added before we start listening for changes, so they don't
+  // cause a write on every launch.
+  AddHSTSPreloadsWithExpiry(transport_security_state_, preloads,
+                            preload_expiry_);
+  for (auto it = preloads.begin(); it != preloads.end(); ++it) {
+    auto canonical_host =
+        net::TransportSecurityState::CanonicalizeHost(it->host);
+    if (!canonical_host.empty())
+      preload_hosts_.insert(crypto::SHA256HashString(canonical_host));
+  }
+
+  transport_security_state_->SetDelegate(this);
+
+  base::PostTaskAndReplyWithResult(
+      background_runner.get(),
+      FROM_HERE,
+      base::Bind(&LoadState, writer_.path()),
+      base::Bind(&TransportSecurityPersister::CompleteLoad,
+                 weak_factory_.GetWeakPtr()));
+}
+
+TransportSecurityPersister::~TransportSecurityPersister() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  if (writer_.HasPendingWrite())
+    writer_.DoScheduledWrite();
+
+  transport_security_state_->SetDelegate(NULL);
+}
+
+void TransportSecurityPersister::StateIsDirty(
+    net::TransportSecurityState* state) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  DCHECK_EQ(transport_security_state_, state);
+
+  writer_.ScheduleWrite(this);
+}
+
+bool TransportSecurityPersister::SerializeData(std::string* output) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  base::DictionaryValue toplevel;
+  auto now = base::Time::Now();
+  net::TransportSecurityState::Iterator state(*transport_security_state_);
+  for (; state.HasNext(); state.Advance()) {
+    const auto& domain_state = state.domain_state();
+    bool has_hsts = domain_state.upgrade_mode ==
+        net::TransportSecurityState::DomainState::MODE_FORCE_HTTPS &&
+        domain_state.upgrade_expiry > now;
+    bool has_pins = !domain_state.dynamic_spki_hashes.empty() &&
+        domain_state.dynamic_spki_hashes_expiry > now;
+    if (!has_hsts && !has_pins)
+      continue;
+    // A preload the site hasn't overridden is added again on next launch.
+    if (!has_pins && preload_hosts_.count(state.hostname()) &&
+        domain_state.upgrade_expiry == preload_expiry_)
+      continue;
+
+    // The iterator yields hashes of the host names, which aren't valid UTF-8.
+    std::string key;
+    if (!base::Base64Encode(state.hostname(), &key))
+      continue;
+
+    auto serialized = new base::DictionaryValue;
+    serialized->SetBoolean(kIncludeSubdomainsKey,
+                           domain_state.sts_include_subdomains);
+    serialized->SetBoolean(kPinsIncludeSubdomainsKey,
+                           domain_state.pkp_include_subdomains);
+    serialized->SetString(kModeKey,
+                          has_hsts ? kForceHTTPSValue : kDefaultValue);
+    serialized->SetDouble(kCreatedKey, domain_state.created.ToDoubleT());
+    serialized->SetDouble(kExpiryKey, domain_state.upgrade_expiry.ToDoubleT());
+    serialized->SetDouble(kDynamicSPKIHashesExpiryKey,
+                          domain_state.dynamic_spki_hashes_expiry.ToDoubleT());
+    if (has_pins) {
+      serialized->Set(kDynamicSPKIHashesKey,
+                      SPKIHashesToListValue(domain_state.dynamic_spki_hashes));
+    }
+    toplevel.SetWithoutPathExpansion(key, serialized);
+  }
+
+  base::JSONWriter::WriteWithOptions(
+      &toplevel, base::JSONWriter::OPTIONS_PRETTY_PRINT, output);
+  return true;
+}
+
+void TransportSecurityPersister::CompleteLoad(const std::string& serialized) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  if (serialized.empty())
+    return;
+
+  scoped_ptr<base::Value> value(base::JSONReader::Read(serialized));
+  base::DictionaryValue* toplevel;
+  if (!value || !value->GetAsDictionary(&toplevel)) {
+    LOG(WARNING) << "Could not parse " << writer_.path().value();
+    return;
+  }
+
+  // Anything learned since startup is newer than what's on disk. Untouched
+  // preloads aren't: a saved entry for a preloaded host holds what the site
+  // itself sent, such as pins or a longer max-age, and replaces the preload.
+  std::set<std::string> known_hosts;
+  net::TransportSecurityState::Iterator state(*transport_security_state_);
+  for (; state.HasNext(); state.Advance()) {
+    const auto& domain_state = state.domain_state();
+    if (preload_hosts_.count(state.hostname()) &&
+        domain_state.upgrade_expiry == preload_expiry_ &&
+        domain_state.dynamic_spki_hashes.empty())
+      continue;
+    known_hosts.insert(state.hostname());
+  }
+
+  auto now = base::Time::Now();
+  bool dirty = false;
+  for (base::DictionaryValue::Iterator it(*toplevel); !it.IsAtEnd();
+       it.Advance()) {
+    const base::DictionaryValue* parsed;
+    std::string hashed_host;
+    if (!it.value().GetAsDictionary(&parsed) ||
+        !base::Base64Decode(it.key(), &hashed_host) ||
+        hashed_host.empty()) {
+      dirty = true;
+      continue;
+    }
+    if (known_hosts.count(hashed_host))
+      continue;
+
+    net::TransportSecurityState::DomainState domain_state;
+    std::string mode_string;
+    double created, expiry, dynamic_spki_hashes_expiry = 0.0;
+    if (!parsed->GetBoolean(kIncludeSubdomainsKey,
+                            &domain_state.sts_include_subdomains) ||
+        !parsed->GetBoolean(kPinsIncludeSubdomainsKey,
+                            &domain_state.pkp_include_subdomains) ||
+        !parsed->GetString(kModeKey, &mode_string) ||
+        !parsed->GetDouble(kCreatedKey, &created) ||
+        !parsed->GetDouble(kExpiryKey, &expiry)) {
+      dirty = true;
+      continue;
+    }
+    parsed->GetDouble(kDynamicSPKIHashesExpiryKey,
+                      &dynamic_spki_hashes_expiry);
+
+    domain_state.upgrade_mode = mode_string == kForceHTTPSValue ?
+        net::TransportSecurityState::DomainState::MODE_FORCE_HTTPS :
+        net::TransportSecurityState::DomainState::MODE_DEFAULT;
+    domain_state.created = base::Time::FromDoubleT(created);
+    domain_state.upgrade_expiry = base::Time::FromDoubleT(expiry);
+    domain_state.dynamic_spki_hashes_expiry =
+        base::Time::FromDoubleT(dynamic_spki_hashes_expiry);
+
+    const base::ListValue* pins;
+    if (parsed->GetList(kDynamicSPKIHashesKey, &pins))
+      ListValueToSPKIHashes(*pins, &domain_state.dynamic_spki_hashes);
+
+    bool has_hsts = domain_state.upgrade_expiry > now &&
+        domain_state.upgrade_mode ==
+            net::TransportSecurityState::DomainState::MODE_FORCE_HTTPS;
+    bool has_pins = domain_state.dynamic_spki_hashes_expiry > now &&
+        !domain_state.dynamic_spki_hashes.empty();
+    if (!has_hsts && !has_pins) {
+      // Expired entries are dropped the next time the file is written.
+      dirty = true;
+      continue;
+    }
+
+    transport_security_state_->AddOrUpdateEnabledHosts(hashed_host,
+                                                       domain_state);
+  }
+
+  if (dirty)
+    StateIsDirty(transport_security_state_);
+}
+
+}  // namespace brightray
@@ -0,0 +1,84 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE-CHROMIUM file.
+
+#ifndef BRIGHTRAY_BROWSER_NET_TRANSPORT_SECURITY_PERSISTER_H_
+#define BRIGHTRAY_BROWSER_NET_TRANSPORT_SECURITY_PERSISTER_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/important_file_writer.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "net/http/transport_security_state.h"
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace brightray {
+
+// A host that should always be upgraded to HTTPS, in addition to the ones
+// built into net::TransportSecurityState.
+struct HSTSPreload {
+  HSTSPreload(const std::string& host, bool include_subdomains)
+      : host(host), include_subdomains(include_subdomains) {
+  }
+
+  std::string host;
+  bool include_subdomains;
+};
+
+typedef std::vector<HSTSPreload> HSTSPreloadList;
+
+// Adds |preloads| to |state|. TransportSecurityPersister does this itself;
+// this is for states that aren't persisted.
+void AddHSTSPreloads(net::TransportSecurityState* state,
+                     const HSTSPreloadList& preloads);
+
+// Saves the HSTS and public key pinning state that sites set dynamically to
+// <profile>/TransportSecurity, and restores it on the next launch. Preloads
+// are added again on every launch and aren't saved, unless a site has since
+// set its own state.
+//
+// The file is read and written on |background_runner|. Changes are coalesced
+// by an ImportantFileWriter, so a burst of Strict-Transport-Security headers
+// results in a single write. Must be created and destroyed on the IO thread,
+// before |state| is destroyed.
+class TransportSecurityPersister
+    : public net::TransportSecurityState::Delegate,
+      public base::ImportantFileWriter::DataSerializer {
+ public:
+  TransportSecurityPersister(
+      net::TransportSecurityState* state,
+      const base::FilePath& profile_path,
+      const scoped_refptr<base::SequencedTaskRunner>& background_runner,
+      const HSTSPreloadList& preloads);
+  virtual ~TransportSecurityPersister();
+
+  // net::TransportSecurityState::Delegate:
+  virtual void StateIsDirty(net::TransportSecurityState* state) OVERRIDE;
+
+  // base::ImportantFileWriter::DataSerializer:
+  virtual bool SerializeData(std::string* data) OVERRIDE;
+
+ private:
+  void CompleteLoad(const std::string& serialized);
+
+  net::TransportSecurityState* transport_security_state_;
+  // The hashed host names of the preloads, and the expiry they were added
+  // with, to tell them apart from state set by the sites themselves.
+  std::set<std::string> preload_hosts_;
+  base::Time preload_expiry_;
+  base::ImportantFileWriter writer_;
+  base::WeakPtrFactory<TransportSecurityPersister> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(TransportSecurityPersister);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,179 @@
+#include "browser/net/url_request_mapped_job.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/format_macros.h"
+#include "base/strings/stringprintf.h"
+#include "base/task_runner.h"
+#include "net/base/filter.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_response_info.h"
+#include "net/http/http_util.h"
+#include "net/url_request/url_request_status.h"
+
+namespace brightray {
+
+namespace {
+
+// Run on the read task runner. |data_owner| keeps |data| mapped even if the
+// job goes away meanwhile.
+void CopyData(const base::Closure& data_owner,
+              const char* data,
+              scoped_refptr<net::IOBuffer> buf,
+              size_t count) {
+  memcpy(buf->data(), data, count);
+}
+
+}  // namespace
+
+URLRequestMappedJob::URLRequestMappedJob(
+    net::URLRequest* request,
+    net::NetworkDelegate* network_delegate,
+    base::TaskRunner* read_task_runner)
+    : net::URLRequestJob(request, network_delegate),
+      read_task_runner_(read_task_runner),
+      has_range_(false),
+      partial_(false),
+      response_begin_(0),
+      response_end_(0),
+      read_offset_(0),
+      gzipped_(false),
+      weak_factory_(this) {
+}
+
+URLRequestMappedJob::~URLRequestMappedJob() {
+}
+
+void URLRequestMappedJob::SetExtraRequestHeaders(
+    const net::HttpRequestHeaders& headers) {
+  std::string range_header;
+  if (!headers.GetHeader(net::HttpRequestHeaders::kRange, &range_header))
+    return;
+
+  // Multiple ranges would need a multipart response, so like
+  // URLRequestFileJob we only honor a single one and ignore the rest.
+  std::vector<net::HttpByteRange> ranges;
+  if (net::HttpUtil::ParseRangeHeader(range_header, &ranges) &&
+      ranges.size() == 1) {
+    byte_range_ = ranges[0];
+    has_range_ = true;
+  }
+}
+
+void URLRequestMappedJob::Kill() {
+  weak_factory_.InvalidateWeakPtrs();
+  net::URLRequestJob::Kill();
+}
+
+void URLRequestMappedJob::SetData(const base::StringPiece& data,
+                                  const base::Closure& data_owner,
+                                  const std::string& mime_type,
+                                  bool gzipped) {
+  data_ = data;
+  data_owner_ = data_owner;
+  mime_type_ = mime_type;
+  gzipped_ = gzipped;
+  response_begin_ = 0;
+  response_end_ = data_.size();
+
+  // A range of gzipped bytes can't be decoded on its own, so those requests
+  // get the whole response.
+  if (has_range_ && !gzipped_) {
+    if (!byte_range_.ComputeBounds(data_.size())) {
+      OnDataFailed(net::ERR_REQUEST_RANGE_NOT_SATISFIABLE);
+      return;
+    }
+    partial_ = true;
+    response_begin_ = byte_range_.first_byte_position();
+    response_end_ = byte_range_.last_byte_position() + 1;
+  }
+
+  read_offset_ = response_begin_;
+  set_expected_content_size(response_end_ - response_begin_);
+  NotifyHeadersComplete();
+}
+
+void URLRequestMappedJob::OnDataFailed(int error) {
+  NotifyStartError(net::URLRequestStatus(net::URLRequestStatus::FAILED,
+                                         error));
+}
+
+bool URLRequestMappedJob::ReadRawData(net::IOBuffer* buf,
+                                      int buf_size,
+                                      int* bytes_read) {
+  DCHECK_GE(buf_size, 0);
+  size_t count = std::min(response_end_ - read_offset_,
+                          static_cast<size_t>(buf_size));
+  if (count == 0) {
+    *bytes_read = 0;
+    return true;
+  }
+
+  WillReadRange(read_offset_, read_offset_ + count);
+  if (!read_task_runner_) {
+    memcpy(buf->data(), data_.data() + read_offset_, count);
+    read_offset_ += count;
+    *bytes_read = count;
+    return true;
+  }
+
+  read_task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&CopyData, data_owner_, data_.data() + read_offset_,
+                 make_scoped_refptr(buf), count),
+      base::Bind(&URLRequestMappedJob::DidRead, weak_factory_.GetWeakPtr(),
+                 static_cast<int>(count)));
+  SetStatus(net::URLRequestStatus(net::URLRequestStatus::IO_PENDING, 0));
+  return false;
+}
+
+void URLRequestMappedJob::DidRead(int bytes_read) {
+  read_offset_ += bytes_read;
+  SetStatus(net::URLRequestStatus());
+  NotifyReadComplete(bytes_read);
+}
+
+bool URLRequestMappedJob::GetMimeType(std::string* mime_type) const {
+  *mime_type = mime_type_;
+  return !mime_type_.empty();
+}
+
+int URLRequestMappedJob::GetResponseCode() const {
+  return partial_ ? 206 : 200;
+}
+
+void URLRequestMappedJob::GetResponseInfo(net::HttpResponseInfo* info) {
+  std::string raw_headers = partial_ ?
+      "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+  if (!mime_type_.empty())
+    raw_headers += "Content-Type: " + mime_type_ + "\r\n";
+  raw_headers += base::StringPrintf("Content-Length: %" PRIuS "\r\n",
+                                    response_end_ - response_begin_);
+  if (gzipped_) {
+    raw_headers += "Content-Encoding: gzip\r\n";
+  } else {
+    raw_headers += "Accept-Ranges: bytes\r\n";
+    if (partial_) {
+      raw_headers += base::StringPrintf(
+          "Content-Range: bytes %" PRIuS "-%" PRIuS "/%" PRIuS "\r\n",
+          response_begin_,
+          response_end_ - 1,
+          data_.size());
+    }
+  }
+  raw_headers += "\r\n";
+
+  info->headers = new net::HttpResponseHeaders(
+      net::HttpUtil::AssembleRawHeaders(raw_headers.data(),
+                                        raw_headers.size()));
+}
+
+net::Filter* URLRequestMappedJob::SetupFilter() const {
+  return gzipped_ ? net::Filter::GZipFactory() : NULL;
+}
+
+}  // namespace brightray
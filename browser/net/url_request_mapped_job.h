@@ -0,0 +1,104 @@
+#ifndef BRIGHTRAY_BROWSER_NET_URL_REQUEST_MAPPED_JOB_H_
+#define BRIGHTRAY_BROWSER_NET_URL_REQUEST_MAPPED_JOB_H_
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/strings/string_piece.h"
+#include "net/http/http_byte_range.h"
+#include "net/url_request/url_request_job.h"
+
+namespace base {
+class TaskRunner;
+}
+
+namespace brightray {
+
+// Base class for jobs that serve a response straight out of a memory-mapped
+// file. Reads copy from the mapping into the caller's buffer without any
+// intermediate buffers or file system calls. Touching the mapping can
+// fault pages in from disk, so if |read_task_runner| is given the copy runs
+// there and the read completes asynchronously. Without one, reads complete
+// synchronously, which suits small data that is already in memory.
+//
+// Handles single-range "Range" requests with 206 responses, and serves
+// gzipped data with "Content-Encoding: gzip" and a matching filter.
+//
+// Subclasses implement Start() and call OnDataReady() or OnDataFailed()
+// asynchronously once they know what to serve.
+class URLRequestMappedJob : public net::URLRequestJob {
+ public:
+  URLRequestMappedJob(net::URLRequest* request,
+                      net::NetworkDelegate* network_delegate,
+                      base::TaskRunner* read_task_runner);
+
+  // net::URLRequestJob:
+  virtual void Kill() OVERRIDE;
+  virtual void SetExtraRequestHeaders(
+      const net::HttpRequestHeaders& headers) OVERRIDE;
+  virtual bool ReadRawData(net::IOBuffer* buf,
+                           int buf_size,
+                           int* bytes_read) OVERRIDE;
+  virtual bool GetMimeType(std::string* mime_type) const OVERRIDE;
+  virtual int GetResponseCode() const OVERRIDE;
+  virtual void GetResponseInfo(net::HttpResponseInfo* info) OVERRIDE;
+  virtual net::Filter* SetupFilter() const OVERRIDE;
+
+ protected:
+  virtual ~URLRequestMappedJob();
+
+  // |data| must stay valid for as long as |owner| is alive. Both the job
+  // and the reads still copying from |data| hold on to |owner|, since those
+  // can outlive the job.
+  template <typename T>
+  void OnDataReady(const base::StringPiece& data,
+                   const scoped_refptr<T>& owner,
+                   const std::string& mime_type,
+                   bool gzipped) {
+    SetData(data, base::Bind(&KeepAlive<T>, owner), mime_type, gzipped);
+  }
+  void OnDataFailed(int error);
+
+  // Called before each read copies the bytes [begin, end) of the data, so
+  // subclasses can hint to the OS what to page in next.
+  virtual void WillReadRange(size_t begin, size_t end) {}
+
+ private:
+  template <typename T>
+  static void KeepAlive(const scoped_refptr<T>& owner) {}
+
+  // |data_owner| holds the reference that keeps |data| valid.
+  void SetData(const base::StringPiece& data,
+               const base::Closure& data_owner,
+               const std::string& mime_type,
+               bool gzipped);
+  void DidRead(int bytes_read);
+
+  scoped_refptr<base::TaskRunner> read_task_runner_;
+
+  net::HttpByteRange byte_range_;
+  bool has_range_;
+  bool partial_;
+
+  base::StringPiece data_;
+  base::Closure data_owner_;
+  // The part of |data_| that makes up the response body, and how much of it
+  // has been read.
+  size_t response_begin_;
+  size_t response_end_;
+  size_t read_offset_;
+
+  std::string mime_type_;
+  bool gzipped_;
+
+  base::WeakPtrFactory<URLRequestMappedJob> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLRequestMappedJob);
+};
+
+}  // namespace brightray
+
+#endif
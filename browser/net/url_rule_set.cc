@@ -0,0 +1,129 @@
+#include "browser/net/url_rule_set.h"
+
+#include <algorithm>
+
+#include "base/strings/string_util.h"
+
+namespace brightray {
+
+namespace {
+
+std::string NormalizeHostPattern(const std::string& pattern) {
+  std::string host = StringToLowerASCII(pattern);
+  if (host == "*")
+    return std::string();
+  if (StartsWithASCII(host, "*.", true))
+    host.erase(0, 2);
+  else if (StartsWithASCII(host, ".", true))
+    host.erase(0, 1);
+  return host;
+}
+
+bool CharLess(const std::pair<char, int32>& child, char c) {
+  return child.first < c;
+}
+
+}  // namespace
+
+// static
+scoped_refptr<URLRuleSet> URLRuleSet::Compile(const URLRuleList& rules) {
+  scoped_refptr<URLRuleSet> rule_set(new URLRuleSet);
+  rule_set->rules_ = rules;
+
+  for (size_t i = 0; i < rules.size(); ++i) {
+    auto host = NormalizeHostPattern(rules[i].host);
+    auto it = rule_set->hosts_.find(host);
+    int32 node;
+    if (it == rule_set->hosts_.end()) {
+      node = rule_set->AddNode();
+      rule_set->hosts_[host] = node;
+    } else {
+      node = it->second;
+    }
+
+    const auto& prefix = rules[i].path_prefix;
+    for (auto c = prefix.begin(); c != prefix.end(); ++c)
+      node = rule_set->GetOrAddChild(node, *c);
+    rule_set->nodes_[node].rules.push_back(i);
+  }
+
+  return rule_set;
+}
+
+URLRuleSet::URLRuleSet() {
+}
+
+URLRuleSet::~URLRuleSet() {
+}
+
+void URLRuleSet::Match(const GURL& url,
+                       std::vector<const URLRule*>* matches) const {
+  if (!url.is_valid() || rules_.empty())
+    return;
+
+  std::vector<int32> rule_indices;
+  auto path = url.path();
+
+  // Try the host itself, then each parent domain, then the wildcard.
+  auto host = url.host();
+  while (true) {
+    auto it = hosts_.find(host);
+    if (it != hosts_.end())
+      MatchPath(it->second, path, &rule_indices);
+    if (host.empty())
+      break;
+    auto dot = host.find('.');
+    if (dot == std::string::npos)
+      host.clear();
+    else
+      host.erase(0, dot + 1);
+  }
+
+  std::sort(rule_indices.begin(), rule_indices.end());
+  for (auto it = rule_indices.begin(); it != rule_indices.end(); ++it)
+    matches->push_back(&rules_[*it]);
+}
+
+int32 URLRuleSet::AddNode() {
+  nodes_.push_back(Node());
+  return nodes_.size() - 1;
+}
+
+int32 URLRuleSet::GetOrAddChild(int32 node, char c) {
+  auto& children = nodes_[node].children;
+  auto it = std::lower_bound(children.begin(), children.end(), c, CharLess);
+  if (it != children.end() && it->first == c)
+    return it->second;
+
+  // AddNode() may reallocate |nodes_|, so look the children up again after.
+  auto index = it - children.begin();
+  int32 child = AddNode();
+  auto& new_children = nodes_[node].children;
+  new_children.insert(new_children.begin() + index, std::make_pair(c, child));
+  return child;
+}
+
+int32 URLRuleSet::FindChild(int32 node, char c) const {
+  const auto& children = nodes_[node].children;
+  auto it = std::lower_bound(children.begin(), children.end(), c, CharLess);
+  if (it == children.end() || it->first != c)
+    return -1;
+  return it->second;
+}
+
+void URLRuleSet::MatchPath(int32 root,
+                           const std::string& path,
+                           std::vector<int32>* rule_indices) const {
+  int32 node = root;
+  for (size_t i = 0; ; ++i) {
+    const auto& rules = nodes_[node].rules;
+    rule_indices->insert(rule_indices->end(), rules.begin(), rules.end());
+    if (i == path.size())
+      break;
+    node = FindChild(node, path[i]);
+    if (node < 0)
+      break;
+  }
+}
+
+}  // namespace brightray
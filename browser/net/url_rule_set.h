@@ -0,0 +1,89 @@
+#ifndef BRIGHTRAY_BROWSER_NET_URL_RULE_SET_H_
+#define BRIGHTRAY_BROWSER_NET_URL_RULE_SET_H_
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "base/memory/ref_counted.h"
+#include "url/gurl.h"
+
+namespace brightray {
+
+// Something to do with requests whose URL matches a host and path pattern.
+struct URLRule {
+  enum Action {
+    // Fail the request with net::ERR_BLOCKED_BY_CLIENT.
+    ACTION_BLOCK,
+    // Send the request to |redirect_url| instead.
+    ACTION_REDIRECT,
+    // Add or replace the request header |header_name|.
+    ACTION_SET_HEADER,
+  };
+
+  URLRule() : action(ACTION_BLOCK) {}
+
+  // Matches this host and all of its subdomains. A leading "*." is ignored.
+  // An empty pattern or "*" matches every host.
+  std::string host;
+  // Matches paths that start with this string. Empty matches every path.
+  std::string path_prefix;
+
+  Action action;
+  GURL redirect_url;
+  std::string header_name;
+  std::string header_value;
+};
+
+typedef std::vector<URLRule> URLRuleList;
+
+// An immutable index over a URLRuleList. Looking up a URL costs one hash
+// lookup per label of its host plus one step per character of its path, no
+// matter how many rules there are.
+//
+// Compiling a large list takes a while, so do it off the IO thread and hand
+// the result over; since a rule set never changes once built, it can be
+// shared between threads freely.
+class URLRuleSet : public base::RefCountedThreadSafe<URLRuleSet> {
+ public:
+  static scoped_refptr<URLRuleSet> Compile(const URLRuleList& rules);
+
+  // Appends the rules that match |url| to |matches|, in the order they
+  // appeared in the list the set was compiled from.
+  void Match(const GURL& url, std::vector<const URLRule*>* matches) const;
+
+  size_t size() const { return rules_.size(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<URLRuleSet>;
+
+  // A node of a character trie over path prefixes. Children are sorted by
+  // character so they can be binary searched.
+  struct Node {
+    std::vector<std::pair<char, int32> > children;
+    std::vector<int32> rules;
+  };
+
+  URLRuleSet();
+  ~URLRuleSet();
+
+  int32 AddNode();
+  int32 GetOrAddChild(int32 node, char c);
+  int32 FindChild(int32 node, char c) const;
+  void MatchPath(int32 root,
+                 const std::string& path,
+                 std::vector<int32>* rule_indices) const;
+
+  URLRuleList rules_;
+  std::vector<Node> nodes_;
+  // Maps a normalized host pattern to the root of its path trie. The empty
+  // string holds the rules that match every host.
+  base::hash_map<std::string, int32> hosts_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLRuleSet);
+};
+
+}  // namespace brightray
+
+#endif
@@ -4,27 +4,119 @@
 
 #include "browser/network_delegate.h"
 
+#include "base/bind.h"
+#include "base/task_runner_util.h"
+#include "base/threading/sequenced_worker_pool.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/browser/resource_request_info.h"
 #include "net/base/net_errors.h"
+#include "net/http/http_request_headers.h"
+#include "net/url_request/url_request.h"
+
+using content::BrowserThread;
 
 namespace brightray {
 
-NetworkDelegate::NetworkDelegate() {
+NetworkDelegate::NetworkDelegate()
+    : url_rules_generation_(0),
+      weak_factory_(this) {
 }
 
 NetworkDelegate::~NetworkDelegate() {
 }
 
+void NetworkDelegate::SetURLRules(const URLRuleList& rules) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  base::PostTaskAndReplyWithResult(
+      BrowserThread::GetBlockingPool(),
+      FROM_HERE,
+      base::Bind(&URLRuleSet::Compile, rules),
+      base::Bind(&NetworkDelegate::OnURLRulesCompiled,
+                 weak_factory_.GetWeakPtr(),
+                 ++url_rules_generation_));
+}
+
+void NetworkDelegate::OnURLRulesCompiled(int generation,
+                                         scoped_refptr<URLRuleSet> rules) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (generation != url_rules_generation_)
+    return;
+  url_rules_.swap(rules);
+}
+
+void NetworkDelegate::SetRequestSchedulerConfig(
+    const RequestSchedulerConfig& config) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  scheduler_.SetConfig(config);
+}
+
+RequestClass NetworkDelegate::ClassifyRequest(
+    const net::URLRequest& request) {
+  auto info = content::ResourceRequestInfo::ForRequest(&request);
+  if (!info)
+    return REQUEST_CLASS_BACKGROUND;
+  if (info->GetResourceType() == ResourceType::PREFETCH ||
+      request.priority() == net::IDLE)
+    return REQUEST_CLASS_PREFETCH;
+  return REQUEST_CLASS_INTERACTIVE;
+}
+
 int NetworkDelegate::OnBeforeURLRequest(
     net::URLRequest* request,
     const net::CompletionCallback& callback,
     GURL* new_url) {
-  return net::OK;
+  stats_recorder_.OnRequestStarted(request);
+
+  if (url_rules_) {
+    std::vector<const URLRule*> matches;
+    url_rules_->Match(request->url(), &matches);
+    for (auto it = matches.begin(); it != matches.end(); ++it) {
+      const auto& rule = **it;
+      if (rule.action == URLRule::ACTION_BLOCK)
+        return net::ERR_BLOCKED_BY_CLIENT;
+      // Don't redirect a request to itself, or it would never finish.
+      if (rule.action == URLRule::ACTION_REDIRECT &&
+          rule.redirect_url.is_valid() &&
+          rule.redirect_url != request->url()) {
+        *new_url = rule.redirect_url;
+        return net::OK;
+      }
+    }
+  }
+
+  // The scheduler drops the callback when |request| goes away, and it can't
+  // outlive us.
+  int rv = scheduler_.ScheduleRequest(
+      request,
+      ClassifyRequest(*request),
+      base::Bind(&NetworkDelegate::OnRequestScheduled,
+                 base::Unretained(this), request, callback));
+  if (rv == net::OK)
+    stats_recorder_.OnRequestScheduled(*request);
+  return rv;
+}
+
+void NetworkDelegate::OnRequestScheduled(
+    net::URLRequest* request,
+    const net::CompletionCallback& callback,
+    int result) {
+  stats_recorder_.OnRequestScheduled(*request);
+  callback.Run(result);
 }
 
 int NetworkDelegate::OnBeforeSendHeaders(
     net::URLRequest* request,
     const net::CompletionCallback& callback,
     net::HttpRequestHeaders* headers) {
+  if (!url_rules_)
+    return net::OK;
+
+  std::vector<const URLRule*> matches;
+  url_rules_->Match(request->url(), &matches);
+  for (auto it = matches.begin(); it != matches.end(); ++it) {
+    if ((*it)->action == URLRule::ACTION_SET_HEADER)
+      headers->SetHeader((*it)->header_name, (*it)->header_value);
+  }
   return net::OK;
 }
 
@@ -46,16 +138,22 @@ void NetworkDelegate::OnBeforeRedirect(net::URLRequest* request,
 }
 
 void NetworkDelegate::OnResponseStarted(net::URLRequest* request) {
+  stats_recorder_.OnResponseStarted(request);
 }
 
 void NetworkDelegate::OnRawBytesRead(const net::URLRequest& request,
-                                          int bytes_read) {
+                                     int bytes_read) {
+  stats_recorder_.OnRawBytesRead(request, bytes_read);
 }
 
 void NetworkDelegate::OnCompleted(net::URLRequest* request, bool started) {
+  stats_recorder_.OnCompleted(request);
+  scheduler_.RemoveRequest(request);
 }
 
 void NetworkDelegate::OnURLRequestDestroyed(net::URLRequest* request) {
+  stats_recorder_.OnRequestDestroyed(request);
+  scheduler_.RemoveRequest(request);
 }
 
 void NetworkDelegate::OnPACScriptError(int line_number,
@@ -100,6 +198,7 @@ int NetworkDelegate::OnBeforeSocketStreamConnect(
 void NetworkDelegate::OnRequestWaitStateChange(
     const net::URLRequest& request,
     RequestWaitState waiting) {
+  stats_recorder_.OnWaitStateChange(request, waiting);
 }
 
 }  // namespace brightray
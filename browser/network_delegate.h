@@ -5,6 +5,11 @@
 #ifndef BRIGHTRAY_BROWSER_NETWORK_DELEGATE_H_
 #define BRIGHTRAY_BROWSER_NETWORK_DELEGATE_H_
 
+#include "browser/net/network_stats.h"
+#include "browser/net/request_scheduler.h"
+#include "browser/net/url_rule_set.h"
+
+#include "base/memory/weak_ptr.h"
 #include "net/base/network_delegate.h"
 
 namespace brightray {
@@ -14,7 +19,35 @@ class NetworkDelegate : public net::NetworkDelegate {
   NetworkDelegate();
   virtual ~NetworkDelegate();
 
+  // Compiles |rules| on the blocking pool, then starts applying them to new
+  // requests in place of the previous rules. Requests keep flowing through
+  // the old rules while the new ones compile. Must be called on the IO
+  // thread.
+  void SetURLRules(const URLRuleList& rules);
+
+  // Timings and byte counts of the requests that have completed so far. Must
+  // be called on the IO thread.
+  const NetworkStats& stats() const { return stats_recorder_.stats(); }
+
+  // Changes how many requests may run at once. Must be called on the IO
+  // thread.
+  void SetRequestSchedulerConfig(const RequestSchedulerConfig& config);
+
+  // Must be called on the IO thread.
+  const RequestSchedulerStats& request_scheduler_stats() const {
+    return scheduler_.stats();
+  }
+
  protected:
+  // Subclasses should override this to change how requests are prioritized
+  // by the request scheduler. By default, requests made by the browser
+  // itself are background requests, prefetches are prefetch requests and
+  // everything else made by a page is interactive.
+  virtual RequestClass ClassifyRequest(const net::URLRequest& request);
+
+  // Subclasses that override any of these should call the implementation
+  // here, which applies the URL rules, schedules requests and records
+  // request statistics.
   virtual int OnBeforeURLRequest(net::URLRequest* request,
                                  const net::CompletionCallback& callback,
                                  GURL* new_url) OVERRIDE;
@@ -59,6 +92,22 @@ class NetworkDelegate : public net::NetworkDelegate {
                                         RequestWaitState state) OVERRIDE;
 
  private:
+  void OnURLRulesCompiled(int generation, scoped_refptr<URLRuleSet> rules);
+  // Runs when the scheduler lets a queued request start.
+  void OnRequestScheduled(net::URLRequest* request,
+                          const net::CompletionCallback& callback,
+                          int result);
+
+  NetworkStatsRecorder stats_recorder_;
+  RequestScheduler scheduler_;
+
+  scoped_refptr<URLRuleSet> url_rules_;
+  // Incremented by SetURLRules() so that a slow compile can't replace the
+  // rules from a later call.
+  int url_rules_generation_;
+
+  base::WeakPtrFactory<NetworkDelegate> weak_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(NetworkDelegate);
 };
 
@@ -6,8 +6,14 @@
 
 #include <algorithm>
 
+#include "browser/net/http_server_properties_manager.h"
+#include "browser/net/sqlite_server_bound_cert_store.h"
+#include "browser/net/tiered_cache_backend.h"
+#include "browser/net/transport_security_persister.h"
 #include "browser/network_delegate.h"
 
+#include "base/bind.h"
+#include "base/message_loop/message_loop_proxy.h"
 #include "base/strings/string_util.h"
 #include "base/threading/sequenced_worker_pool.h"
 #include "base/threading/worker_pool.h"
@@ -18,12 +24,14 @@
 #include "net/cookies/cookie_monster.h"
 #include "net/http/http_auth_handler_factory.h"
 #include "net/http/http_cache.h"
-#include "net/http/http_server_properties_impl.h"
 #include "net/proxy/dhcp_proxy_script_fetcher_factory.h"
+#include "net/proxy/network_delegate_error_observer.h"
+#include "net/proxy/proxy_config.h"
 #include "net/proxy/proxy_config_service.h"
+#include "net/proxy/proxy_config_service_fixed.h"
+#include "net/proxy/proxy_resolver_v8_tracing.h"
 #include "net/proxy/proxy_script_fetcher_impl.h"
 #include "net/proxy/proxy_service.h"
-#include "net/proxy/proxy_service_v8.h"
 #include "net/ssl/default_server_bound_cert_store.h"
 #include "net/ssl/server_bound_cert_service.h"
 #include "net/ssl/ssl_config_service_defaults.h"
@@ -36,23 +44,73 @@
 
 namespace brightray {
 
+namespace {
+
+// How long the result of evaluating the PAC script for a host is reused.
+const int kProxyResolutionCacheSeconds = 300;
+
+scoped_ptr<net::ProxyResolver> CreateV8ProxyResolver(
+    net::HostResolver* host_resolver,
+    net::NetworkDelegate* network_delegate) {
+  auto error_observer = new net::NetworkDelegateErrorObserver(
+      network_delegate, base::MessageLoopProxy::current().get());
+  return scoped_ptr<net::ProxyResolver>(new net::ProxyResolverV8Tracing(
+      host_resolver, error_observer, NULL));
+}
+
+void IgnoreCacheBackend(disk_cache::Backend** backend, int result) {
+}
+
+void IgnoreCookies(const net::CookieList& cookies) {
+}
+
+void IgnoreServerBoundCerts(
+    const net::ServerBoundCertStore::ServerBoundCertList& certs) {
+}
+
+}  // namespace
+
 URLRequestContextGetter::URLRequestContextGetter(
     const base::FilePath& base_path,
+    bool in_memory,
+    URLRequestContextGetter* network_core,
     base::MessageLoop* io_loop,
     base::MessageLoop* file_loop,
     base::Callback<scoped_ptr<NetworkDelegate>(void)> network_delegate_factory,
+    const HttpCacheConfig& http_cache_config,
+    scoped_ptr<net::ProxyConfig> fixed_proxy_config,
+    scoped_ptr<HttpServerPropertiesManager> http_server_properties_manager,
+    const HSTSPreloadList& hsts_preloads,
     content::ProtocolHandlerMap* protocol_handlers)
     : base_path_(base_path),
+      in_memory_(in_memory),
+      network_core_(network_core),
       io_loop_(io_loop),
       file_loop_(file_loop),
-      network_delegate_factory_(network_delegate_factory) {
+      network_delegate_factory_(network_delegate_factory),
+      http_cache_config_(http_cache_config),
+      fixed_proxy_config_(fixed_proxy_config.Pass()),
+      http_server_properties_manager_(http_server_properties_manager.Pass()),
+      hsts_preloads_(hsts_preloads),
+      server_bound_cert_store_(nullptr) {
   // Must first be created on the UI thread.
   DCHECK(content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
+  DCHECK(!in_memory_ ||
+         http_cache_config_.mode == HttpCacheConfig::MODE_MEMORY);
+  DCHECK(!network_core_ || !http_server_properties_manager_);
 
   std::swap(protocol_handlers_, *protocol_handlers);
 
-  proxy_config_service_.reset(net::ProxyService::CreateSystemProxyConfigService(
-      io_loop_->message_loop_proxy(), file_loop_));
+#if defined(OS_LINUX)
+  // ProxyConfigServiceLinux watches GSettings/gconf through the glib main
+  // loop, so it has to be created on the UI thread. Everywhere else it is
+  // created on the IO thread along with the rest of the network stack.
+  if (!fixed_proxy_config_ && !network_core_) {
+    proxy_config_service_.reset(
+        net::ProxyService::CreateSystemProxyConfigService(
+            io_loop_->message_loop_proxy(), file_loop_));
+  }
+#endif
 }
 
 URLRequestContextGetter::~URLRequestContextGetter() {
@@ -62,109 +120,225 @@ net::HostResolver* URLRequestContextGetter::host_resolver() {
   return url_request_context_->host_resolver();
 }
 
+void URLRequestContextGetter::WarmUp() {
+  DCHECK(content::BrowserThread::CurrentlyOn(content::BrowserThread::IO));
+
+  auto context = GetURLRequestContext();
+
+  // Each of these completes asynchronously on its own thread, and whatever
+  // they load is picked up by the first request that needs it.
+  auto backend = new disk_cache::Backend*(NULL);
+  context->http_transaction_factory()->GetCache()->GetBackend(
+      backend, base::Bind(&IgnoreCacheBackend, base::Owned(backend)));
+  context->cookie_store()->GetCookieMonster()->GetAllCookiesAsync(
+      base::Bind(&IgnoreCookies));
+  context->server_bound_cert_service()->GetCertStore()->GetAllServerBoundCerts(
+      base::Bind(&IgnoreServerBoundCerts));
+  context->proxy_service()->ForceReloadProxyConfig();
+}
+
 net::URLRequestContext* URLRequestContextGetter::GetURLRequestContext() {
   DCHECK(content::BrowserThread::CurrentlyOn(content::BrowserThread::IO));
 
   if (!url_request_context_.get()) {
     url_request_context_.reset(new net::URLRequestContext());
+    // Borrow the network core's pointers; everything that holds state of
+    // this context is replaced below.
+    if (network_core_)
+      url_request_context_->CopyFrom(network_core_->GetURLRequestContext());
     network_delegate_ = network_delegate_factory_.Run().Pass();
     url_request_context_->set_network_delegate(network_delegate_.get());
     storage_.reset(
         new net::URLRequestContextStorage(url_request_context_.get()));
-    storage_->set_cookie_store(content::CreatePersistentCookieStore(
-        base_path_.Append(FILE_PATH_LITERAL("Cookies")),
-        false,
-        nullptr,
-        nullptr,
-        nullptr));
-    storage_->set_server_bound_cert_service(new net::ServerBoundCertService(
-        new net::DefaultServerBoundCertStore(NULL),
-        base::WorkerPool::GetTaskRunner(true)));
+    if (in_memory_) {
+      storage_->set_cookie_store(new net::CookieMonster(nullptr, nullptr));
+    } else {
+      storage_->set_cookie_store(content::CreatePersistentCookieStore(
+          base_path_.Append(FILE_PATH_LITERAL("Cookies")),
+          false,
+          nullptr,
+          nullptr,
+          nullptr));
+    }
     storage_->set_http_user_agent_settings(
         new net::StaticHttpUserAgentSettings(
             "en-us,en", EmptyString()));
 
-    scoped_ptr<net::HostResolver> host_resolver(
-        net::HostResolver::CreateDefaultResolver(NULL));
-
-    net::DhcpProxyScriptFetcherFactory dhcp_factory;
-    storage_->set_proxy_service(
-        net::CreateProxyServiceUsingV8ProxyResolver(
-            proxy_config_service_.release(),
-            new net::ProxyScriptFetcherImpl(url_request_context_.get()),
-            dhcp_factory.Create(url_request_context_.get()),
-            host_resolver.get(),
-            NULL,
-            url_request_context_->network_delegate()));
-
-    storage_->set_cert_verifier(net::CertVerifier::CreateDefault());
-    storage_->set_transport_security_state(new net::TransportSecurityState);
-    storage_->set_ssl_config_service(new net::SSLConfigServiceDefaults);
-    storage_->set_http_auth_handler_factory(
-        net::HttpAuthHandlerFactory::CreateDefault(host_resolver.get()));
-    scoped_ptr<net::HttpServerProperties> server_properties(
-        new net::HttpServerPropertiesImpl);
-    storage_->set_http_server_properties(server_properties.Pass());
+    auto transport_security_state = new net::TransportSecurityState;
+    storage_->set_transport_security_state(transport_security_state);
+    if (in_memory_) {
+      AddHSTSPreloads(transport_security_state, hsts_preloads_);
+    } else {
+      transport_security_persister_.reset(new TransportSecurityPersister(
+          transport_security_state,
+          base_path_,
+          content::BrowserThread::GetMessageLoopProxyForThread(
+              content::BrowserThread::FILE),
+          hsts_preloads_));
+    }
 
     base::FilePath cache_path = base_path_.Append(FILE_PATH_LITERAL("Cache"));
-    net::HttpCache::DefaultBackend* main_backend =
-        new net::HttpCache::DefaultBackend(
-            net::DISK_CACHE,
-            net::CACHE_BACKEND_DEFAULT,
-            cache_path,
-            0,
-            content::BrowserThread::GetMessageLoopProxyForThread(
-                content::BrowserThread::CACHE));
-
-    net::HttpNetworkSession::Params network_session_params;
-    network_session_params.cert_verifier =
-        url_request_context_->cert_verifier();
-    network_session_params.transport_security_state =
-        url_request_context_->transport_security_state();
-    network_session_params.server_bound_cert_service =
-        url_request_context_->server_bound_cert_service();
-    network_session_params.proxy_service =
-        url_request_context_->proxy_service();
-    network_session_params.ssl_config_service =
-        url_request_context_->ssl_config_service();
-    network_session_params.http_auth_handler_factory =
-        url_request_context_->http_auth_handler_factory();
-    network_session_params.network_delegate =
-        url_request_context_->network_delegate();
-    network_session_params.http_server_properties =
-        url_request_context_->http_server_properties();
-    network_session_params.ignore_certificate_errors = false;
-
-    // Give |storage_| ownership at the end in case it's |mapped_host_resolver|.
-    storage_->set_host_resolver(host_resolver.Pass());
-    network_session_params.host_resolver =
-        url_request_context_->host_resolver();
-
-    net::HttpCache* main_cache = new net::HttpCache(
-        network_session_params, main_backend);
-    storage_->set_http_transaction_factory(main_cache);
+    auto main_backend = new TieredCacheBackendFactory(
+        http_cache_config_,
+        cache_path,
+        content::BrowserThread::GetMessageLoopProxyForThread(
+            content::BrowserThread::CACHE),
+        &http_cache_stats_);
 
-    scoped_ptr<net::URLRequestJobFactoryImpl> job_factory(
-        new net::URLRequestJobFactoryImpl());
-    for (auto it = protocol_handlers_.begin(),
-        end = protocol_handlers_.end(); it != end; ++it) {
-      bool set_protocol = job_factory->SetProtocolHandler(
-          it->first, it->second.release());
-      DCHECK(set_protocol);
+    net::HttpCache* main_cache;
+    if (network_core_) {
+      auto session = network_core_->GetURLRequestContext()->
+          http_transaction_factory()->GetSession();
+      main_cache = new net::HttpCache(session, main_backend);
+    } else {
+      main_cache = new net::HttpCache(CreateNetworkSessionParams(),
+                                      main_backend);
     }
-    protocol_handlers_.clear();
+    storage_->set_http_transaction_factory(main_cache);
+
+    storage_->set_job_factory(CreateJobFactory(&protocol_handlers_));
+  }
+
+  return url_request_context_.get();
+}
+
+net::HttpNetworkSession::Params
+    URLRequestContextGetter::CreateNetworkSessionParams() {
+  if (!in_memory_) {
+    server_bound_cert_persistent_store_ = new SQLiteServerBoundCertStore(
+        base_path_.Append(FILE_PATH_LITERAL("Origin Bound Certs")),
+        content::BrowserThread::GetMessageLoopProxyForThread(
+            content::BrowserThread::DB));
+  }
+  server_bound_cert_store_ = new CountingServerBoundCertStore(
+      server_bound_cert_persistent_store_.get());
+  storage_->set_server_bound_cert_service(new net::ServerBoundCertService(
+      server_bound_cert_store_, base::WorkerPool::GetTaskRunner(true)));
+
+  scoped_ptr<net::HostResolver> host_resolver(
+      net::HostResolver::CreateDefaultResolver(NULL));
+
+  storage_->set_proxy_service(CreateProxyService(host_resolver.get()));
+
+  storage_->set_cert_verifier(net::CertVerifier::CreateDefault());
+  storage_->set_ssl_config_service(new net::SSLConfigServiceDefaults);
+  storage_->set_http_auth_handler_factory(
+      net::HttpAuthHandlerFactory::CreateDefault(host_resolver.get()));
+  http_server_properties_manager_->InitializeOnIOThread();
+  storage_->set_http_server_properties(
+      http_server_properties_manager_.PassAs<net::HttpServerProperties>());
+
+  net::HttpNetworkSession::Params network_session_params;
+  network_session_params.cert_verifier =
+      url_request_context_->cert_verifier();
+  network_session_params.transport_security_state =
+      url_request_context_->transport_security_state();
+  network_session_params.server_bound_cert_service =
+      url_request_context_->server_bound_cert_service();
+  network_session_params.proxy_service =
+      url_request_context_->proxy_service();
+  network_session_params.ssl_config_service =
+      url_request_context_->ssl_config_service();
+  network_session_params.http_auth_handler_factory =
+      url_request_context_->http_auth_handler_factory();
+  network_session_params.network_delegate =
+      url_request_context_->network_delegate();
+  network_session_params.http_server_properties =
+      url_request_context_->http_server_properties();
+  network_session_params.ignore_certificate_errors = false;
+
+  // Give |storage_| ownership at the end in case it's |mapped_host_resolver|.
+  storage_->set_host_resolver(host_resolver.Pass());
+  network_session_params.host_resolver =
+      url_request_context_->host_resolver();
+  return network_session_params;
+}
+
+// static
+net::URLRequestJobFactory* URLRequestContextGetter::CreateJobFactory(
+    content::ProtocolHandlerMap* protocol_handlers) {
+  auto job_factory = new net::URLRequestJobFactoryImpl;
+  for (auto it = protocol_handlers->begin(),
+      end = protocol_handlers->end(); it != end; ++it) {
+    bool set_protocol = job_factory->SetProtocolHandler(
+        it->first, it->second.release());
+    DCHECK(set_protocol);
+  }
+  protocol_handlers->clear();
+
+  // The embedder's handlers, e.g. MappedFileProtocolHandler, take precedence
+  // over the defaults. SetProtocolHandler() doesn't take ownership when it
+  // fails, so the defaults are only created for schemes nobody handles.
+  if (!job_factory->IsHandledProtocol(chrome::kDataScheme)) {
     job_factory->SetProtocolHandler(
         chrome::kDataScheme, new net::DataProtocolHandler);
+  }
+  if (!job_factory->IsHandledProtocol(chrome::kFileScheme)) {
     job_factory->SetProtocolHandler(
         chrome::kFileScheme,
         new net::FileProtocolHandler(
             content::BrowserThread::GetBlockingPool()->
                 GetTaskRunnerWithShutdownBehavior(
                     base::SequencedWorkerPool::SKIP_ON_SHUTDOWN)));
-    storage_->set_job_factory(job_factory.release());
   }
+  return job_factory;
+}
 
-  return url_request_context_.get();
+ServerBoundCertStats URLRequestContextGetter::server_bound_cert_stats() const {
+  DCHECK(content::BrowserThread::CurrentlyOn(content::BrowserThread::IO));
+
+  ServerBoundCertStats stats;
+  if (!url_request_context_)
+    return stats;
+
+  auto service = url_request_context_->server_bound_cert_service();
+  if (server_bound_cert_persistent_store_) {
+    stats.loaded_certs =
+        server_bound_cert_persistent_store_->loaded_cert_count();
+  }
+  stats.requests = service->requests();
+  stats.reused_certs = service->cert_store_hits() + service->inflight_joins();
+  // Requests can also fail or be cancelled, so generations are counted
+  // where the service stores their result.
+  auto store = network_core_ ? network_core_->server_bound_cert_store_ :
+                               server_bound_cert_store_;
+  if (store)
+    stats.generated_certs = store->stored_cert_count();
+  return stats;
+}
+
+net::ProxyService* URLRequestContextGetter::CreateProxyService(
+    net::HostResolver* host_resolver) {
+  // A fixed configuration without PAC or WPAD needs neither the system
+  // configuration nor a PAC resolver.
+  if (fixed_proxy_config_ && !fixed_proxy_config_->HasAutomaticSettings())
+    return net::ProxyService::CreateFixed(*fixed_proxy_config_);
+
+  net::ProxyConfigService* config_service;
+  if (fixed_proxy_config_) {
+    config_service = new net::ProxyConfigServiceFixed(*fixed_proxy_config_);
+  } else if (proxy_config_service_) {
+    config_service = proxy_config_service_.release();
+  } else {
+    config_service = net::ProxyService::CreateSystemProxyConfigService(
+        io_loop_->message_loop_proxy(), file_loop_);
+  }
+
+  // The V8 resolver is only created once the configuration turns out to use
+  // PAC or WPAD.
+  auto resolver = new CachingProxyResolver(
+      base::Bind(&CreateV8ProxyResolver,
+                 host_resolver,
+                 url_request_context_->network_delegate()),
+      base::TimeDelta::FromSeconds(kProxyResolutionCacheSeconds),
+      &proxy_resolver_stats_);
+  auto proxy_service = new net::ProxyService(config_service, resolver, NULL);
+
+  net::DhcpProxyScriptFetcherFactory dhcp_factory;
+  proxy_service->SetProxyScriptFetchers(
+      new net::ProxyScriptFetcherImpl(url_request_context_.get()),
+      dhcp_factory.Create(url_request_context_.get()));
+  return proxy_service;
 }
 
 scoped_refptr<base::SingleThreadTaskRunner>
@@ -5,10 +5,16 @@
 #ifndef BRIGHTRAY_BROWSER_URL_REQUEST_CONTEXT_GETTER_H_
 #define BRIGHTRAY_BROWSER_URL_REQUEST_CONTEXT_GETTER_H_
 
+#include "browser/net/caching_proxy_resolver.h"
+#include "browser/net/http_cache_config.h"
+#include "browser/net/sqlite_server_bound_cert_store.h"
+#include "browser/net/transport_security_persister.h"
+
 #include "base/callback.h"
 #include "base/files/file_path.h"
 #include "base/memory/scoped_ptr.h"
 #include "content/public/browser/content_browser_client.h"
+#include "net/http/http_network_session.h"
 #include "net/url_request/url_request_context_getter.h"
 
 namespace base {
@@ -17,41 +23,118 @@ class MessageLoop;
 
 namespace net {
 class HostResolver;
+class ProxyConfig;
 class ProxyConfigService;
+class ProxyService;
 class URLRequestContextStorage;
+class URLRequestJobFactory;
 }
 
 namespace brightray {
 
+class HttpServerPropertiesManager;
 class NetworkDelegate;
 
 class URLRequestContextGetter : public net::URLRequestContextGetter {
  public:
+  // When |in_memory| is true, nothing is read from or written to
+  // |base_path|: cookies, server-bound certs and HSTS state are kept in
+  // memory only, and |http_cache_config| must use MODE_MEMORY.
+  //
+  // When |network_core| is non-null, the context borrows its host resolver,
+  // cert verifier, proxy service, SSL config, auth handlers, server
+  // properties, server-bound certs and HttpNetworkSession instead of
+  // creating its own, so DNS and cert verification results and idle sockets
+  // are pooled. The proxy config and server properties manager passed here
+  // must then be null. Cookies, the HTTP cache and protocol handlers stay
+  // separate. The context also has its own HSTS state and network delegate,
+  // which URLRequests use, but the shared session was built with the
+  // owner's: connections check the owner's HSTS state (e.g. for pins) and
+  // report session-level events to the owner's network delegate. Both
+  // contexts must therefore be off the record or both not.
   URLRequestContextGetter(
       const base::FilePath& base_path,
+      bool in_memory,
+      URLRequestContextGetter* network_core,
       base::MessageLoop* io_loop,
       base::MessageLoop* file_loop,
       base::Callback<scoped_ptr<NetworkDelegate>(void)>,
+      const HttpCacheConfig&,
+      scoped_ptr<net::ProxyConfig> fixed_proxy_config,
+      scoped_ptr<HttpServerPropertiesManager>,
+      const HSTSPreloadList&,
       content::ProtocolHandlerMap*);
   virtual ~URLRequestContextGetter();
 
   net::HostResolver* host_resolver();
+
+  // Null until GetURLRequestContext() has been called. Must be called on the
+  // IO thread.
+  NetworkDelegate* network_delegate() const { return network_delegate_.get(); }
+
+  // Builds the URLRequestContext if needed and starts opening the HTTP cache
+  // backend, loading the cookie and server-bound cert databases and fetching
+  // the proxy configuration in parallel, so the first request finds them
+  // ready. Must be called on the IO thread.
+  void WarmUp();
+
+  // Must be called on the IO thread.
+  const HttpCacheStats& http_cache_stats() const { return http_cache_stats_; }
+  const ProxyResolverStats& proxy_resolver_stats() const {
+    return proxy_resolver_stats_;
+  }
+  ServerBoundCertStats server_bound_cert_stats() const;
+
+  // The hosts every TransportSecurityState built from this context starts
+  // out with. Can be called on any thread.
+  const HSTSPreloadList& hsts_preloads() const { return hsts_preloads_; }
+
   virtual net::URLRequestContext* GetURLRequestContext() OVERRIDE;
 
+  // Returns a job factory that serves |protocol_handlers| (which it takes
+  // ownership of), plus data: and file: URLs unless they handle those.
+  static net::URLRequestJobFactory* CreateJobFactory(
+      content::ProtocolHandlerMap* protocol_handlers);
+
  private:
   virtual scoped_refptr<base::SingleThreadTaskRunner>
       GetNetworkTaskRunner() const OVERRIDE;
 
+  // Creates the parts of the network stack that can be shared with other
+  // contexts, and returns the parameters of a session built on them.
+  net::HttpNetworkSession::Params CreateNetworkSessionParams();
+  net::ProxyService* CreateProxyService(net::HostResolver* host_resolver);
+
   base::FilePath base_path_;
+  bool in_memory_;
+  scoped_refptr<URLRequestContextGetter> network_core_;
   base::MessageLoop* io_loop_;
   base::MessageLoop* file_loop_;
 
   base::Callback<scoped_ptr<NetworkDelegate>(void)> network_delegate_factory_;
+  HttpCacheConfig http_cache_config_;
+
+  // Declared before |storage_| since the cache backend and the proxy resolver
+  // write to them until they are destroyed.
+  HttpCacheStats http_cache_stats_;
+  ProxyResolverStats proxy_resolver_stats_;
 
+  // Null when the system proxy configuration should be used.
+  scoped_ptr<net::ProxyConfig> fixed_proxy_config_;
   scoped_ptr<net::ProxyConfigService> proxy_config_service_;
+  // Handed to |storage_| once the context is built.
+  scoped_ptr<HttpServerPropertiesManager> http_server_properties_manager_;
+  HSTSPreloadList hsts_preloads_;
   scoped_ptr<NetworkDelegate> network_delegate_;
+  // Null when |in_memory_| or |network_core_|.
+  scoped_refptr<SQLiteServerBoundCertStore> server_bound_cert_persistent_store_;
+  // Owned by the ServerBoundCertService. Null when |network_core_|.
+  CountingServerBoundCertStore* server_bound_cert_store_;
   scoped_ptr<net::URLRequestContextStorage> storage_;
   scoped_ptr<net::URLRequestContext> url_request_context_;
+  // Declared after |storage_| so it's destroyed before the state it watches.
+  // Null when |in_memory_|.
+  scoped_ptr<TransportSecurityPersister> transport_security_persister_;
   content::ProtocolHandlerMap protocol_handlers_;
 
   DISALLOW_COPY_AND_ASSIGN(URLRequestContextGetter);
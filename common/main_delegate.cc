@@ -6,6 +6,8 @@
 
 #include "browser/browser_client.h"
 #include "common/content_client.h"
+#include "common/resource_bundle_delegate.h"
+#include "common/startup_timeline.h"
 
 #include "base/command_line.h"
 #include "base/path_service.h"
@@ -25,12 +27,14 @@ scoped_ptr<ContentClient> MainDelegate::CreateContentClient() {
 }
 
 bool MainDelegate::BasicStartupComplete(int* exit_code) {
+  ScopedStartupPhase phase("MainDelegate::BasicStartupComplete");
   content_client_ = CreateContentClient().Pass();
   SetContentClient(content_client_.get());
   return false;
 }
 
 void MainDelegate::PreSandboxStartup() {
+  ScopedStartupPhase phase("MainDelegate::PreSandboxStartup");
 #if defined(OS_MACOSX)
   OverrideChildProcessPath();
   OverrideFrameworkBundlePath();
@@ -39,6 +43,7 @@ void MainDelegate::PreSandboxStartup() {
 }
 
 void MainDelegate::InitializeResourceBundle() {
+  ScopedStartupPhase phase("MainDelegate::InitializeResourceBundle");
   base::FilePath path;
 #if defined(OS_MACOSX)
   path = GetResourcesPakFilePath();
@@ -48,14 +53,31 @@ void MainDelegate::InitializeResourceBundle() {
   path = pak_dir.Append(FILE_PATH_LITERAL("content_shell.pak"));
 #endif
 
-  ui::ResourceBundle::InitSharedInstanceWithPakPath(path);
+  // Only the main pak is opened here. The delegate hands it to the
+  // ResourceBundle as both its resource and locale pack, and maps the
+  // others the first time a resource is looked up in them.
+  resource_bundle_delegate_.reset(new ResourceBundleDelegate(path));
 
   std::vector<base::FilePath> pak_paths;
   AddPakPaths(&pak_paths);
-  for (auto it = pak_paths.begin(), end = pak_paths.end(); it != end; ++it) {
-    ui::ResourceBundle::GetSharedInstance().AddDataPackFromPath(
-        *it, ui::SCALE_FACTOR_NONE);
+  for (auto it = pak_paths.begin(), end = pak_paths.end(); it != end; ++it)
+    resource_bundle_delegate_->AddPakPath(*it);
+
+  ui::ResourceBundle::InitSharedInstanceWithLocale(
+      std::string(), resource_bundle_delegate_.get());
+
+  // Child processes can't open files once they're sandboxed, so they map
+  // everything now.
+  auto command_line = CommandLine::ForCurrentProcess();
+  if (command_line->HasSwitch(switches::kProcessType)) {
+    resource_bundle_delegate_->LoadAll();
+    return;
   }
+
+  std::vector<base::FilePath> read_ahead_paths;
+  AddReadAheadPakPaths(&read_ahead_paths);
+  if (!read_ahead_paths.empty())
+    resource_bundle_delegate_->ReadAheadInBackground(read_ahead_paths);
 }
 
 content::ContentBrowserClient* MainDelegate::CreateContentBrowserClient() {
@@ -19,6 +19,7 @@ namespace brightray {
 
 class BrowserClient;
 class ContentClient;
+class ResourceBundleDelegate;
 
 class MainDelegate : public content::ContentMainDelegate {
  public:
@@ -38,6 +39,12 @@ class MainDelegate : public content::ContentMainDelegate {
   // included in the ui::ResourceBundle.
   virtual void AddPakPaths(std::vector<base::FilePath>* pak_paths) {}
 
+  // Subclasses can override this to name the paks from AddPakPaths() that
+  // are needed for the first paint. The browser process reads them into the
+  // page cache in the background during startup; other paks are only read
+  // once a resource is looked up in them.
+  virtual void AddReadAheadPakPaths(std::vector<base::FilePath>* pak_paths) {}
+
   virtual bool BasicStartupComplete(int* exit_code) OVERRIDE;
   virtual void PreSandboxStartup() OVERRIDE;
 
@@ -53,6 +60,7 @@ class MainDelegate : public content::ContentMainDelegate {
 
   scoped_ptr<ContentClient> content_client_;
   scoped_ptr<BrowserClient> browser_client_;
+  scoped_ptr<ResourceBundleDelegate> resource_bundle_delegate_;
 
   DISALLOW_COPY_AND_ASSIGN(MainDelegate);
 };
@@ -0,0 +1,257 @@
+#include "common/resource_bundle_delegate.h"
+
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/sys_byteorder.h"
+#include "base/threading/worker_pool.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/base/resource/data_pack.h"
+#include "ui/gfx/codec/png_codec.h"
+#include "ui/gfx/font.h"
+#include "ui/gfx/image/image.h"
+
+namespace brightray {
+
+namespace {
+
+// See ui/base/resource/data_pack.cc for the format.
+const uint32 kPakFileVersion = 4;
+const size_t kPakHeaderSize = 2 * sizeof(uint32) + sizeof(uint8);
+const size_t kPakEntrySize = sizeof(uint16) + sizeof(uint32);
+
+// Reads only the header and the index table of the pak at |path|, rather
+// than mapping the whole file.
+bool ReadPakResourceIds(const base::FilePath& path, std::vector<uint16>* ids) {
+  file_util::ScopedFILE file(file_util::OpenFile(path, "rb"));
+  if (!file)
+    return false;
+
+  char header[kPakHeaderSize];
+  if (fread(header, 1, sizeof(header), file.get()) != sizeof(header))
+    return false;
+  uint32 version, count;
+  memcpy(&version, header, sizeof(version));
+  memcpy(&count, header + sizeof(version), sizeof(count));
+  if (base::ByteSwapToLE32(version) != kPakFileVersion)
+    return false;
+  count = base::ByteSwapToLE32(count);
+
+  // The table ends with a sentinel entry, which isn't a resource.
+  std::vector<char> table(count * kPakEntrySize);
+  if (!table.empty() &&
+      fread(&table[0], 1, table.size(), file.get()) != table.size())
+    return false;
+
+  ids->reserve(count);
+  for (size_t i = 0; i < table.size(); i += kPakEntrySize) {
+    uint16 id;
+    memcpy(&id, &table[i], sizeof(id));
+    ids->push_back(base::ByteSwapToLE16(id));
+  }
+  return true;
+}
+
+// Pulls the file at |path| into the page cache.
+void ReadAhead(const base::FilePath& path) {
+#if defined(OS_LINUX)
+  int fd = HANDLE_EINTR(open(path.value().c_str(), O_RDONLY));
+  if (fd < 0)
+    return;
+  struct stat info;
+  if (fstat(fd, &info) == 0)
+    readahead(fd, 0, info.st_size);
+  ignore_result(HANDLE_EINTR(close(fd)));
+#else
+  file_util::ScopedFILE file(file_util::OpenFile(path, "rb"));
+  if (!file)
+    return;
+  char buffer[64 * 1024];
+  while (fread(buffer, 1, sizeof(buffer), file.get()) == sizeof(buffer)) {
+  }
+#endif
+}
+
+}  // namespace
+
+const size_t ResourceBundleDelegate::kMainPak = static_cast<size_t>(-1);
+
+struct ResourceBundleDelegate::Pak {
+  explicit Pak(const base::FilePath& path) : path(path), failed(false) {}
+
+  base::FilePath path;
+  scoped_ptr<ui::DataPack> pack;
+  // Set once mapping |path| has failed, so it isn't retried on every lookup.
+  bool failed;
+};
+
+ResourceBundleDelegate::ResourceBundleDelegate(
+    const base::FilePath& main_pak_path)
+    : main_pak_path_(main_pak_path),
+      index_built_(false) {
+}
+
+ResourceBundleDelegate::~ResourceBundleDelegate() {
+}
+
+void ResourceBundleDelegate::AddPakPath(const base::FilePath& path) {
+  base::AutoLock locker(lock_);
+  DCHECK(!index_built_);
+  paks_.push_back(new Pak(path));
+}
+
+void ResourceBundleDelegate::LoadAll() {
+  base::AutoLock locker(lock_);
+  EnsureIndexLocked();
+  for (size_t i = 0; i < paks_.size(); ++i)
+    GetPackLocked(paks_[i]);
+}
+
+void ResourceBundleDelegate::ReadAheadInBackground(
+    const std::vector<base::FilePath>& paths) {
+  // Unretained is safe because we outlive the shared ResourceBundle, which
+  // is never deleted before the process exits.
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ResourceBundleDelegate::ReadAheadOnWorkerThread,
+                 base::Unretained(this),
+                 paths),
+      true);
+}
+
+void ResourceBundleDelegate::ReadAheadOnWorkerThread(
+    const std::vector<base::FilePath>& paths) {
+  {
+    base::AutoLock locker(lock_);
+    EnsureIndexLocked();
+  }
+  for (auto it = paths.begin(); it != paths.end(); ++it)
+    ReadAhead(*it);
+}
+
+void ResourceBundleDelegate::EnsureIndexLocked() {
+  lock_.AssertAcquired();
+  if (index_built_)
+    return;
+  index_built_ = true;
+
+  // ResourceBundle looks in its own packs only after asking us, so the
+  // main pak's ids are claimed first to keep extra paks from shadowing them.
+  std::vector<uint16> main_ids;
+  if (!ReadPakResourceIds(main_pak_path_, &main_ids)) {
+    LOG(ERROR) << "Failed to read the resource index of "
+               << main_pak_path_.value();
+  }
+  for (auto it = main_ids.begin(); it != main_ids.end(); ++it)
+    index_.insert(std::make_pair(*it, kMainPak));
+
+  for (size_t i = 0; i < paks_.size(); ++i) {
+    std::vector<uint16> ids;
+    if (!ReadPakResourceIds(paks_[i]->path, &ids)) {
+      LOG(ERROR) << "Failed to read the resource index of "
+                 << paks_[i]->path.value();
+      paks_[i]->failed = true;
+      continue;
+    }
+    // insert() leaves existing entries alone, so earlier paks win.
+    for (auto it = ids.begin(); it != ids.end(); ++it)
+      index_.insert(std::make_pair(*it, i));
+  }
+}
+
+ui::DataPack* ResourceBundleDelegate::GetPackLocked(Pak* pak) {
+  lock_.AssertAcquired();
+  if (pak->pack || pak->failed)
+    return pak->pack.get();
+
+  scoped_ptr<ui::DataPack> pack(new ui::DataPack(ui::SCALE_FACTOR_NONE));
+  if (!pack->LoadFromPath(pak->path)) {
+    LOG(ERROR) << "Failed to load " << pak->path.value();
+    pak->failed = true;
+    return NULL;
+  }
+  pak->pack = pack.Pass();
+  return pak->pack.get();
+}
+
+base::FilePath ResourceBundleDelegate::GetPathForResourcePack(
+    const base::FilePath& pack_path,
+    ui::ScaleFactor scale_factor) {
+  // The main pak stands in for the common 100% pak. An empty path tells
+  // ResourceBundle to skip the pack, which leaves out the other scale
+  // factors' packs, which we don't ship.
+  if (scale_factor == ui::SCALE_FACTOR_100P)
+    return main_pak_path_;
+  return base::FilePath();
+}
+
+base::FilePath ResourceBundleDelegate::GetPathForLocalePack(
+    const base::FilePath& pack_path,
+    const std::string& locale) {
+  return main_pak_path_;
+}
+
+gfx::Image ResourceBundleDelegate::GetImageNamed(int resource_id) {
+  // ResourceBundle caches what we return, so each image is decoded once.
+  base::StringPiece data;
+  if (!GetRawDataResource(resource_id, ui::SCALE_FACTOR_NONE, &data))
+    return gfx::Image();
+
+  SkBitmap bitmap;
+  if (!gfx::PNGCodec::Decode(
+          reinterpret_cast<const unsigned char*>(data.data()),
+          data.size(),
+          &bitmap)) {
+    LOG(ERROR) << "Failed to decode image resource " << resource_id;
+    return gfx::Image();
+  }
+  return gfx::Image::CreateFrom1xBitmap(bitmap);
+}
+
+gfx::Image ResourceBundleDelegate::GetNativeImageNamed(
+    int resource_id,
+    ui::ResourceBundle::ImageRTL rtl) {
+  return GetImageNamed(resource_id);
+}
+
+base::RefCountedStaticMemory* ResourceBundleDelegate::LoadDataResourceBytes(
+    int resource_id,
+    ui::ScaleFactor scale_factor) {
+  base::StringPiece data;
+  if (!GetRawDataResource(resource_id, scale_factor, &data))
+    return NULL;
+  // Packs stay mapped for as long as we're alive.
+  return new base::RefCountedStaticMemory(
+      reinterpret_cast<const unsigned char*>(data.data()), data.length());
+}
+
+bool ResourceBundleDelegate::GetRawDataResource(int resource_id,
+                                                ui::ScaleFactor scale_factor,
+                                                base::StringPiece* value) {
+  base::AutoLock locker(lock_);
+  EnsureIndexLocked();
+
+  auto it = index_.find(static_cast<uint16>(resource_id));
+  if (it == index_.end() || it->second == kMainPak)
+    return false;
+  auto pack = GetPackLocked(paks_[it->second]);
+  return pack && pack->GetStringPiece(it->first, value);
+}
+
+bool ResourceBundleDelegate::GetLocalizedString(int message_id,
+                                                string16* value) {
+  return false;
+}
+
+scoped_ptr<gfx::Font> ResourceBundleDelegate::GetFont(
+    ui::ResourceBundle::FontStyle style) {
+  return scoped_ptr<gfx::Font>();
+}
+
+}  // namespace brightray
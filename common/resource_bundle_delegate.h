@@ -0,0 +1,94 @@
+#ifndef BRIGHTRAY_COMMON_RESOURCE_BUNDLE_DELEGATE_H_
+#define BRIGHTRAY_COMMON_RESOURCE_BUNDLE_DELEGATE_H_
+
+#include <vector>
+
+#include "base/containers/hash_tables.h"
+#include "base/files/file_path.h"
+#include "base/memory/scoped_vector.h"
+#include "base/synchronization/lock.h"
+#include "ui/base/resource/resource_bundle.h"
+
+namespace ui {
+class DataPack;
+}
+
+namespace brightray {
+
+// Serves resources from extra .pak files without opening them at startup.
+//
+// The main pak is handed to ui::ResourceBundle as its resource and locale
+// pack, the same as ResourceBundle::InitSharedInstanceWithPakPath() would.
+// Extra paks are only registered. The first lookup reads just their index
+// tables to build a single id-to-pak map; a pak is memory-mapped the first
+// time one of its resources is asked for. Like ResourceBundle, the pak added
+// first wins when several contain the same id, and the main pak wins over
+// all of them: ids it contains are left to ResourceBundle. Images in extra
+// paks are decoded from PNG.
+//
+// Must outlive the shared ResourceBundle.
+class ResourceBundleDelegate : public ui::ResourceBundle::Delegate {
+ public:
+  explicit ResourceBundleDelegate(const base::FilePath& main_pak_path);
+  virtual ~ResourceBundleDelegate();
+
+  // Must be called before the first lookup.
+  void AddPakPath(const base::FilePath& path);
+
+  // Builds the index and maps every pak now. Sandboxed processes need this,
+  // since they can't open files later.
+  void LoadAll();
+
+  // Builds the index on a worker thread and reads |paths| into the page
+  // cache there, so mapping them later doesn't fault in every page from
+  // disk on the UI thread.
+  void ReadAheadInBackground(const std::vector<base::FilePath>& paths);
+
+  // ui::ResourceBundle::Delegate:
+  virtual base::FilePath GetPathForResourcePack(
+      const base::FilePath& pack_path,
+      ui::ScaleFactor scale_factor) OVERRIDE;
+  virtual base::FilePath GetPathForLocalePack(
+      const base::FilePath& pack_path,
+      const std::string& locale) OVERRIDE;
+  virtual gfx::Image GetImageNamed(int resource_id) OVERRIDE;
+  virtual gfx::Image GetNativeImageNamed(
+      int resource_id,
+      ui::ResourceBundle::ImageRTL rtl) OVERRIDE;
+  virtual base::RefCountedStaticMemory* LoadDataResourceBytes(
+      int resource_id,
+      ui::ScaleFactor scale_factor) OVERRIDE;
+  virtual bool GetRawDataResource(int resource_id,
+                                  ui::ScaleFactor scale_factor,
+                                  base::StringPiece* value) OVERRIDE;
+  virtual bool GetLocalizedString(int message_id, string16* value) OVERRIDE;
+  virtual scoped_ptr<gfx::Font> GetFont(
+      ui::ResourceBundle::FontStyle style) OVERRIDE;
+
+ private:
+  struct Pak;
+
+  void ReadAheadOnWorkerThread(const std::vector<base::FilePath>& paths);
+
+  // These must be called with |lock_| held.
+  void EnsureIndexLocked();
+  ui::DataPack* GetPackLocked(Pak* pak);
+
+  // Index value for resources found in the main pak.
+  static const size_t kMainPak;
+
+  base::FilePath main_pak_path_;
+
+  base::Lock lock_;
+  ScopedVector<Pak> paks_;
+  bool index_built_;
+  // Maps resource ids to indices in |paks_|, or to kMainPak for ids that
+  // ResourceBundle serves itself.
+  base::hash_map<uint16, size_t> index_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResourceBundleDelegate);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,171 @@
+#include "common/startup_timeline.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common/switches.h"
+
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/json/json_writer.h"
+#include "base/lazy_instance.h"
+#include "base/process/process_handle.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/task_runner.h"
+#include "base/threading/platform_thread.h"
+#include "base/values.h"
+
+namespace brightray {
+
+namespace {
+
+struct Phase {
+  const char* name;
+  base::TimeTicks begin;
+  base::TimeTicks end;
+  base::PlatformThreadId thread_id;
+};
+
+bool PhaseBeginsBefore(const Phase& a, const Phase& b) {
+  return a.begin < b.begin;
+}
+
+class Timeline {
+ public:
+  Timeline()
+      : enabled_(CommandLine::ForCurrentProcess()->HasSwitch(
+            switches::kStartupTimeline)),
+        milestones_(0) {
+  }
+
+  // Returns true when |milestone| completes the set.
+  bool ReachMilestone(int milestone) {
+    base::AutoLock locker(lock_);
+    bool was_complete = milestones_ == StartupTimeline::ALL_MILESTONES;
+    milestones_ |= milestone;
+    return !was_complete && milestones_ == StartupTimeline::ALL_MILESTONES;
+  }
+
+  void AddPhase(const Phase& phase) {
+    base::AutoLock locker(lock_);
+    if (enabled_)
+      phases_.push_back(phase);
+  }
+
+  // Hands out the recorded phases the first time it's called, and stops
+  // recording new ones.
+  bool Finish(std::vector<Phase>* phases) {
+    base::AutoLock locker(lock_);
+    if (!enabled_)
+      return false;
+    enabled_ = false;
+    phases->swap(phases_);
+    return true;
+  }
+
+ private:
+  base::Lock lock_;
+  bool enabled_;
+  int milestones_;
+  std::vector<Phase> phases_;
+
+  DISALLOW_COPY_AND_ASSIGN(Timeline);
+};
+
+base::LazyInstance<Timeline>::Leaky g_timeline = LAZY_INSTANCE_INITIALIZER;
+
+// Timestamps are relative to the beginning of the first phase.
+std::string SerializeTraceEvents(const std::vector<Phase>& phases) {
+  auto origin = phases.front().begin;
+  auto events = new base::ListValue;
+  for (auto it = phases.begin(); it != phases.end(); ++it) {
+    // A complete ("X") event per phase.
+    auto event = new base::DictionaryValue;
+    event->SetString("name", it->name);
+    event->SetString("cat", "startup");
+    event->SetString("ph", "X");
+    event->SetDouble("ts", (it->begin - origin).InMicroseconds());
+    event->SetDouble("dur", (it->end - it->begin).InMicroseconds());
+    event->SetInteger("pid", base::GetCurrentProcId());
+    event->SetInteger("tid", it->thread_id);
+    events->Append(event);
+  }
+
+  base::DictionaryValue trace;
+  trace.Set("traceEvents", events);
+  std::string json;
+  base::JSONWriter::Write(&trace, &json);
+  return json;
+}
+
+std::string Summarize(const std::vector<Phase>& phases) {
+  std::string summary = "Startup timeline (ms):";
+  base::TimeTicks end;
+  for (auto it = phases.begin(); it != phases.end(); ++it) {
+    base::StringAppendF(&summary, " %s=%d", it->name,
+        static_cast<int>((it->end - it->begin).InMilliseconds()));
+    end = std::max(end, it->end);
+  }
+  if (!phases.empty()) {
+    base::StringAppendF(&summary, " total=%d",
+        static_cast<int>((end - phases.front().begin).InMilliseconds()));
+  }
+  return summary;
+}
+
+void WriteTraceFile(const base::FilePath& path, const std::string& json) {
+  int size = static_cast<int>(json.size());
+  if (file_util::WriteFile(path, json.data(), size) != size)
+    LOG(ERROR) << "Couldn't write the startup timeline to " << path.value();
+}
+
+}  // namespace
+
+// static
+void StartupTimeline::ReachMilestone(Milestone milestone,
+                                     base::TaskRunner* file_task_runner) {
+  if (g_timeline.Get().ReachMilestone(milestone))
+    Finish(file_task_runner);
+}
+
+// static
+void StartupTimeline::Finish(base::TaskRunner* file_task_runner) {
+  std::vector<Phase> phases;
+  if (!g_timeline.Get().Finish(&phases) || phases.empty())
+    return;
+
+  // Phases are recorded as they end, so nested ones come before their
+  // parents.
+  std::stable_sort(phases.begin(), phases.end(), &PhaseBeginsBefore);
+  LOG(INFO) << Summarize(phases);
+
+  auto path = CommandLine::ForCurrentProcess()->GetSwitchValuePath(
+      switches::kStartupTimeline);
+  if (path.empty())
+    return;
+  file_task_runner->PostTask(
+      FROM_HERE,
+      base::Bind(&WriteTraceFile, path, SerializeTraceEvents(phases)));
+}
+
+ScopedStartupPhase::ScopedStartupPhase(const char* name)
+    : name_(name),
+      begin_(base::TimeTicks::Now()) {
+  TRACE_EVENT_BEGIN0("startup", name_);
+}
+
+ScopedStartupPhase::~ScopedStartupPhase() {
+  TRACE_EVENT_END0("startup", name_);
+
+  Phase phase;
+  phase.name = name_;
+  phase.begin = begin_;
+  phase.end = base::TimeTicks::Now();
+  phase.thread_id = base::PlatformThread::CurrentId();
+  g_timeline.Get().AddPhase(phase);
+}
+
+}  // namespace brightray
@@ -0,0 +1,56 @@
+#ifndef BRIGHTRAY_COMMON_STARTUP_TIMELINE_H_
+#define BRIGHTRAY_COMMON_STARTUP_TIMELINE_H_
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+
+namespace base {
+class TaskRunner;
+}
+
+namespace brightray {
+
+// Times the phases of brightray's startup. Every phase is a trace event in
+// the "startup" category, so it shows up in about:tracing and in
+// --trace-startup output. When --startup-timeline=<path> is passed, the
+// browser process also keeps the phases and writes them to <path> in the
+// trace event format, along with a one-line summary in the log, once every
+// milestone has been reached.
+class StartupTimeline {
+ public:
+  enum Milestone {
+    // BrowserMainParts::PreMainMessageLoopRun() has returned.
+    MAIN_MESSAGE_LOOP_READY = 1 << 0,
+    // The first request context has been created.
+    REQUEST_CONTEXT_CREATED = 1 << 1,
+    ALL_MILESTONES = MAIN_MESSAGE_LOOP_READY | REQUEST_CONTEXT_CREATED,
+  };
+
+  // Records that |milestone| has been reached, and calls Finish() once all
+  // of them have.
+  static void ReachMilestone(Milestone milestone,
+                             base::TaskRunner* file_task_runner);
+
+  // Writes the timeline on |file_task_runner| if --startup-timeline was
+  // passed and it hasn't been written yet. Phases that end afterwards are
+  // only traced.
+  static void Finish(base::TaskRunner* file_task_runner);
+};
+
+// Marks the current scope as a startup phase.
+class ScopedStartupPhase {
+ public:
+  // |name| must be a string literal.
+  explicit ScopedStartupPhase(const char* name);
+  ~ScopedStartupPhase();
+
+ private:
+  const char* name_;
+  base::TimeTicks begin_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedStartupPhase);
+};
+
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,11 @@
+#include "common/switches.h"
+
+namespace brightray {
+namespace switches {
+
+// Records how long each startup phase takes and writes the result to the
+// given path in the trace event format, plus a one-line summary to the log.
+const char kStartupTimeline[] = "startup-timeline";
+
+}  // namespace switches
+}  // namespace brightray
@@ -0,0 +1,12 @@
+#ifndef BRIGHTRAY_COMMON_SWITCHES_H_
+#define BRIGHTRAY_COMMON_SWITCHES_H_
+
+namespace brightray {
+namespace switches {
+
+extern const char kStartupTimeline[];
+
+}  // namespace switches
+}  // namespace brightray
+
+#endif
@@ -0,0 +1,258 @@
+// Measures how long it takes to open the HTTP cache's disk backend over an
+// existing cache and read one entry from it, for each backend type that
+// HttpCacheConfig::disk_backend_type can select.
+//
+//   cache_backend_benchmark [--entries=N] [--iterations=N]
+//
+// Each backend type gets its own cache, filled with --entries entries, in a
+// temporary directory. Every iteration then creates a new backend through
+// TieredCacheBackendFactory, opens an entry and reads its body, and reports
+// the 50th and 99th percentile of those times. The OS page cache isn't
+// dropped between iterations, so this measures the work the backend does to
+// start up (loading its index, hopping to the cache thread) rather than how
+// fast the disk is.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "browser/net/http_cache_config.h"
+#include "browser/net/tiered_cache_backend.h"
+
+#include "base/at_exit.h"
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/command_line.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/disk_cache/disk_cache.h"
+
+namespace {
+
+const char kEntriesSwitch[] = "entries";
+const char kIterationsSwitch[] = "iterations";
+
+const int kDefaultEntries = 2000;
+const int kDefaultIterations = 200;
+// About the size of a typical script or stylesheet.
+const int kEntrySize = 16 * 1024;
+// The stream HttpCache keeps response bodies in.
+const int kBodyStream = 1;
+
+struct BackendType {
+  const char* name;
+  net::BackendType type;
+};
+
+const BackendType kBackendTypes[] = {
+  { "blockfile", net::CACHE_BACKEND_BLOCKFILE },
+  { "simple", net::CACHE_BACKEND_SIMPLE },
+};
+
+// Runs the message loop until a disk_cache operation completes.
+class CompletionWaiter {
+ public:
+  CompletionWaiter() : result_(net::ERR_IO_PENDING) {}
+
+  net::CompletionCallback callback() {
+    return base::Bind(&CompletionWaiter::OnComplete, base::Unretained(this));
+  }
+
+  // |rv| is what the operation returned when it was started.
+  int WaitForResult(int rv) {
+    if (rv != net::ERR_IO_PENDING)
+      return rv;
+    run_loop_.Run();
+    return result_;
+  }
+
+ private:
+  void OnComplete(int result) {
+    result_ = result;
+    run_loop_.Quit();
+  }
+
+  base::RunLoop run_loop_;
+  int result_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompletionWaiter);
+};
+
+std::string KeyForEntry(int index) {
+  return base::StringPrintf("http://example.com/resource/%d.js", index);
+}
+
+int CreateBackend(net::BackendType type,
+                  const base::FilePath& path,
+                  base::MessageLoopProxy* cache_thread,
+                  scoped_ptr<disk_cache::Backend>* backend) {
+  brightray::HttpCacheConfig config;
+  config.disk_backend_type = type;
+  // The backend keeps counting into this after the factory is gone.
+  static brightray::HttpCacheStats stats;
+  brightray::TieredCacheBackendFactory factory(config, path, cache_thread,
+                                               &stats);
+
+  CompletionWaiter waiter;
+  return waiter.WaitForResult(
+      factory.CreateBackend(NULL, backend, waiter.callback()));
+}
+
+// Lets the cache thread finish whatever a destroyed backend left for it,
+// such as writing out its index.
+void FlushCacheThread(base::MessageLoopProxy* cache_thread) {
+  base::RunLoop run_loop;
+  cache_thread->PostTaskAndReply(FROM_HERE,
+                                 base::Bind(&base::DoNothing),
+                                 run_loop.QuitClosure());
+  run_loop.Run();
+  base::RunLoop().RunUntilIdle();
+}
+
+bool Populate(net::BackendType type,
+              const base::FilePath& path,
+              base::MessageLoopProxy* cache_thread,
+              int entries) {
+  scoped_ptr<disk_cache::Backend> backend;
+  if (CreateBackend(type, path, cache_thread, &backend) != net::OK)
+    return false;
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kEntrySize));
+  memset(buffer->data(), 'x', kEntrySize);
+  for (int i = 0; i < entries; ++i) {
+    disk_cache::Entry* entry;
+    CompletionWaiter create_waiter;
+    int rv = create_waiter.WaitForResult(backend->CreateEntry(
+        KeyForEntry(i), &entry, create_waiter.callback()));
+    if (rv != net::OK)
+      return false;
+
+    CompletionWaiter write_waiter;
+    rv = write_waiter.WaitForResult(entry->WriteData(
+        kBodyStream, 0, buffer.get(), kEntrySize, write_waiter.callback(),
+        false));
+    entry->Close();
+    if (rv != kEntrySize)
+      return false;
+  }
+
+  backend.reset();
+  FlushCacheThread(cache_thread);
+  return true;
+}
+
+// Opens the backend and reads entry |index| from it. Returns a zero time
+// if anything fails.
+base::TimeDelta TimeColdOpen(net::BackendType type,
+                             const base::FilePath& path,
+                             base::MessageLoopProxy* cache_thread,
+                             int index) {
+  auto start = base::TimeTicks::Now();
+
+  scoped_ptr<disk_cache::Backend> backend;
+  if (CreateBackend(type, path, cache_thread, &backend) != net::OK)
+    return base::TimeDelta();
+
+  disk_cache::Entry* entry;
+  CompletionWaiter open_waiter;
+  int rv = open_waiter.WaitForResult(backend->OpenEntry(
+      KeyForEntry(index), &entry, open_waiter.callback()));
+  if (rv != net::OK)
+    return base::TimeDelta();
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kEntrySize));
+  CompletionWaiter read_waiter;
+  rv = read_waiter.WaitForResult(entry->ReadData(
+      kBodyStream, 0, buffer.get(), kEntrySize, read_waiter.callback()));
+  auto elapsed = base::TimeTicks::Now() - start;
+
+  entry->Close();
+  backend.reset();
+  FlushCacheThread(cache_thread);
+  return rv == kEntrySize ? elapsed : base::TimeDelta();
+}
+
+// |sorted_times| must not be empty.
+base::TimeDelta Percentile(const std::vector<base::TimeDelta>& sorted_times,
+                           double percentile) {
+  size_t index = static_cast<size_t>(
+      percentile / 100 * (sorted_times.size() - 1) + 0.5);
+  return sorted_times[index];
+}
+
+int GetIntSwitch(const CommandLine& command_line,
+                 const char* name,
+                 int default_value) {
+  int value;
+  if (!base::StringToInt(command_line.GetSwitchValueASCII(name), &value) ||
+      value <= 0)
+    return default_value;
+  return value;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  base::AtExitManager at_exit_manager;
+  CommandLine::Init(argc, argv);
+  const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+  int entries = GetIntSwitch(command_line, kEntriesSwitch, kDefaultEntries);
+  int iterations = GetIntSwitch(command_line, kIterationsSwitch,
+                                kDefaultIterations);
+
+  base::MessageLoop message_loop(base::MessageLoop::TYPE_IO);
+  base::Thread cache_thread("CacheThread");
+  if (!cache_thread.StartWithOptions(
+          base::Thread::Options(base::MessageLoop::TYPE_IO, 0))) {
+    fprintf(stderr, "Could not start the cache thread\n");
+    return 1;
+  }
+  auto cache_proxy = cache_thread.message_loop_proxy();
+
+  printf("%d entries of %d bytes, %d iterations\n",
+         entries, kEntrySize, iterations);
+  for (size_t i = 0; i < arraysize(kBackendTypes); ++i) {
+    const auto& backend_type = kBackendTypes[i];
+
+    base::ScopedTempDir cache_dir;
+    if (!cache_dir.CreateUniqueTempDir() ||
+        !Populate(backend_type.type, cache_dir.path(), cache_proxy.get(),
+                  entries)) {
+      fprintf(stderr, "Could not populate the %s cache\n", backend_type.name);
+      return 1;
+    }
+
+    // The first open after populating can rebuild an index the backend
+    // didn't get to write, which isn't what a normal launch does.
+    TimeColdOpen(backend_type.type, cache_dir.path(), cache_proxy.get(), 0);
+
+    std::vector<base::TimeDelta> times;
+    for (int j = 0; j < iterations; ++j) {
+      auto time = TimeColdOpen(backend_type.type, cache_dir.path(),
+                               cache_proxy.get(), j % entries);
+      if (time == base::TimeDelta()) {
+        fprintf(stderr, "Could not read from the %s cache\n",
+                backend_type.name);
+        return 1;
+      }
+      times.push_back(time);
+    }
+
+    std::sort(times.begin(), times.end());
+    printf("%-10s p50 %8.2f ms  p99 %8.2f ms\n",
+           backend_type.name,
+           Percentile(times, 50).InMillisecondsF(),
+           Percentile(times, 99).InMillisecondsF());
+  }
+
+  return 0;
+}
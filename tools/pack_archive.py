@@ -0,0 +1,167 @@
+#!/usr/bin/env python
+
+"""Usage: pack_archive.py <source-directory> <output-file>
+
+Packs every file under <source-directory> into a resource archive that
+brightray::ArchiveProtocolHandler can serve. Text-like resources are stored
+gzipped when that makes them smaller, and are served with
+"Content-Encoding: gzip".
+
+FORMAT
+
+All integers are little-endian uint32s, and all offsets are from the start of
+the file.
+
+  header:   "BRAR", version (1), bucket count, entry count
+  buckets:  bucket count x index of the first entry in the bucket, or
+            0xffffffff if the bucket is empty
+  entries:  entry count x (hash, index of the next entry in the same bucket
+            or 0xffffffff, path offset, path length, MIME type offset,
+            MIME type length, data offset, data length, flags)
+  strings:  the paths and MIME types
+  data:     the resources, each aligned to 16 bytes
+
+Paths are relative to <source-directory> and use forward slashes. The hash is
+32-bit FNV-1a of the UTF-8 path, and a path lives in bucket
+hash % bucket count. Entries in a bucket are chained in increasing index
+order. Flag 1 means the data is gzipped.
+"""
+
+import gzip
+import io
+import mimetypes
+import os
+import struct
+import sys
+
+
+MAGIC = b'BRAR'
+VERSION = 1
+NO_ENTRY = 0xffffffff
+FLAG_GZIPPED = 1
+HEADER_SIZE = 16
+ENTRY_SIZE = 36
+DATA_ALIGNMENT = 16
+
+COMPRESSIBLE_TYPES = (
+  'application/javascript',
+  'application/json',
+  'application/xml',
+  'image/svg+xml',
+)
+
+
+def main():
+  if len(sys.argv) != 3:
+    sys.stderr.write(__doc__)
+    return 1
+
+  source, output = sys.argv[1:]
+  resources = read_resources(source)
+  with open(output, 'wb') as f:
+    f.write(pack(resources))
+  return 0
+
+
+def read_resources(source):
+  resources = []
+  for root, dirs, files in os.walk(source):
+    dirs.sort()
+    for name in sorted(files):
+      full_path = os.path.join(root, name)
+      path = os.path.relpath(full_path, source).replace(os.sep, '/')
+      with open(full_path, 'rb') as f:
+        data = f.read()
+      mime_type = guess_mime_type(path)
+      gzipped = False
+      if is_compressible(mime_type):
+        compressed = gzip_data(data)
+        if len(compressed) < len(data):
+          data = compressed
+          gzipped = True
+      resources.append((path.encode('utf-8'), mime_type.encode('ascii'),
+                        data, gzipped))
+  return resources
+
+
+def guess_mime_type(path):
+  mime_type = mimetypes.guess_type(path)[0]
+  if mime_type is None:
+    return 'application/octet-stream'
+  return mime_type
+
+
+def is_compressible(mime_type):
+  return mime_type.startswith('text/') or mime_type in COMPRESSIBLE_TYPES
+
+
+def gzip_data(data):
+  buf = io.BytesIO()
+  # A fixed mtime keeps the output reproducible.
+  with gzip.GzipFile(fileobj=buf, mode='wb', compresslevel=9, mtime=0) as f:
+    f.write(data)
+  return buf.getvalue()
+
+
+def fnv1a(data):
+  value = 2166136261
+  for byte in bytearray(data):
+    value ^= byte
+    value = (value * 16777619) & 0xffffffff
+  return value
+
+
+def align(offset):
+  return (offset + DATA_ALIGNMENT - 1) // DATA_ALIGNMENT * DATA_ALIGNMENT
+
+
+def pack(resources):
+  entry_count = len(resources)
+  # Keep the load factor at or below 0.5 so chains stay short.
+  bucket_count = max(1, entry_count * 2)
+
+  hashes = [fnv1a(path) for path, _, _, _ in resources]
+  buckets = [NO_ENTRY] * bucket_count
+  nexts = [NO_ENTRY] * entry_count
+  # Walk backwards so each chain ends up in increasing index order.
+  for i in reversed(range(entry_count)):
+    bucket = hashes[i] % bucket_count
+    nexts[i] = buckets[bucket]
+    buckets[bucket] = i
+
+  strings_offset = HEADER_SIZE + bucket_count * 4 + entry_count * ENTRY_SIZE
+  strings = bytearray()
+  string_offsets = []
+  for path, mime_type, _, _ in resources:
+    path_offset = strings_offset + len(strings)
+    strings += path
+    mime_type_offset = strings_offset + len(strings)
+    strings += mime_type
+    string_offsets.append((path_offset, mime_type_offset))
+
+  data_offset = align(strings_offset + len(strings))
+  data = bytearray()
+  data_offsets = []
+  for _, _, resource_data, _ in resources:
+    padding = align(data_offset + len(data)) - (data_offset + len(data))
+    data += b'\0' * padding
+    data_offsets.append(data_offset + len(data))
+    data += resource_data
+
+  out = bytearray()
+  out += MAGIC
+  out += struct.pack('<III', VERSION, bucket_count, entry_count)
+  out += struct.pack('<%dI' % bucket_count, *buckets)
+  for i, (path, mime_type, resource_data, gzipped) in enumerate(resources):
+    path_offset, mime_type_offset = string_offsets[i]
+    out += struct.pack('<9I', hashes[i], nexts[i], path_offset, len(path),
+                       mime_type_offset, len(mime_type), data_offsets[i],
+                       len(resource_data), FLAG_GZIPPED if gzipped else 0)
+  out += strings
+  out += b'\0' * (data_offset - len(out))
+  out += data
+  return bytes(out)
+
+
+if __name__ == '__main__':
+  sys.exit(main())